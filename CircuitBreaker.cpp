@@ -0,0 +1,90 @@
+#include "CircuitBreaker.h"
+
+// Constructor
+CCircuitBreaker::CCircuitBreaker(const int iThreshold /* = 3 */, const uint64_t iCoolDown /* = 10000 */)
+  : m_state(STATE_CLOSED), m_iThreshold(iThreshold), m_iFailures(0), m_iCoolDown(iCoolDown), m_iOpenedAt(0), m_bProbeInFlight(false)
+{
+}
+
+
+// Returns true if an attempt to the host may be made now
+bool CCircuitBreaker::AllowAttempt(const uint64_t iNow)
+{
+  switch (m_state)
+  {
+    case STATE_CLOSED:
+      return true;
+
+    case STATE_OPEN:
+      if (iNow - m_iOpenedAt < m_iCoolDown)
+        return false;
+
+      // Cool-down expired: let one probe through
+      m_state = STATE_HALF_OPEN;
+      m_bProbeInFlight = true;
+      return true;
+
+    case STATE_HALF_OPEN:
+      // Only a single probe at a time
+      if (m_bProbeInFlight)
+        return false;
+
+      m_bProbeInFlight = true;
+      return true;
+  }
+
+  return true;
+}
+
+
+void CCircuitBreaker::RecordSuccess(void)
+{
+  m_state = STATE_CLOSED;
+  m_iFailures = 0;
+  m_bProbeInFlight = false;
+}
+
+
+void CCircuitBreaker::RecordFailure(const uint64_t iNow)
+{
+  m_bProbeInFlight = false;
+
+  if (m_iThreshold <= 0)
+    return; // Disabled
+
+  // A failed probe re-opens the breaker immediately
+  if (m_state == STATE_HALF_OPEN || ++m_iFailures >= m_iThreshold)
+  {
+    m_state = STATE_OPEN;
+    m_iOpenedAt = iNow;
+  }
+}
+
+
+// The probe ended without an answer from the host (eg. it couldn't be resolved or had to wait for a
+// credential dialog): let the next attempt probe instead
+void CCircuitBreaker::AbortProbe(void)
+{
+  if (m_state == STATE_HALF_OPEN)
+    m_bProbeInFlight = false;
+}
+
+
+// Open a closed breaker based on an outside report (eg. another process found the host down at iOpenedAt)
+void CCircuitBreaker::ForceOpen(const uint64_t iOpenedAt)
+{
+  if (m_iThreshold <= 0 || m_state != STATE_CLOSED)
+    return;
+
+  m_state = STATE_OPEN;
+  m_iFailures = m_iThreshold;
+  m_iOpenedAt = iOpenedAt;
+}
+
+
+// Let a probe through right away (eg. another process reached the host after the breaker opened)
+void CCircuitBreaker::EndCoolDown(void)
+{
+  if (m_state == STATE_OPEN)
+    m_state = STATE_HALF_OPEN;
+}
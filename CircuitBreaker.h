@@ -0,0 +1,38 @@
+#pragma once
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <stdint.h>
+
+// Per-host circuit breaker: after a number of consecutive failures the host is
+// suspended (open). After the cool-down one probe is let through (half-open) and
+// the breaker closes again on success or re-opens on failure.
+class CCircuitBreaker
+{
+  public:
+    enum EState { STATE_CLOSED, STATE_OPEN, STATE_HALF_OPEN };
+
+    CCircuitBreaker(const int iThreshold = 3, const uint64_t iCoolDown = 10000);
+    ~CCircuitBreaker(void) {}; // Empty destructor
+
+    bool AllowAttempt(const uint64_t iNow);
+    void RecordSuccess(void);
+    void RecordFailure(const uint64_t iNow);
+    void AbortProbe(void);
+    void ForceOpen(const uint64_t iOpenedAt);
+    void EndCoolDown(void);
+
+    EState GetState(void) const { return m_state; };
+    bool IsProbing(void) const { return m_state == STATE_HALF_OPEN; };
+    uint64_t GetOpenedAt(void) const { return m_iOpenedAt; };
+
+  private:
+    EState m_state;
+    int m_iThreshold;                         // Consecutive failures before opening (0 = disabled)
+    int m_iFailures;                          // Current number of consecutive failures
+    uint64_t m_iCoolDown;                     // Time in ms before a probe is allowed
+    uint64_t m_iOpenedAt;                     // Tick count at which the breaker (re-)opened
+    bool m_bProbeInFlight;
+};
+
+#endif // CIRCUIT_BREAKER_H
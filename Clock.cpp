@@ -0,0 +1,34 @@
+#include "Clock.h"
+
+#include <chrono>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <thread>
+#endif
+
+uint64_t CSystemClock::Now(void)
+{
+#ifdef _WIN32
+  return GetTickCount64();
+#else
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+void CSystemClock::Sleep(const uint64_t iTime)
+{
+#ifdef _WIN32
+  ::Sleep((DWORD) iTime);
+#else
+  std::this_thread::sleep_for(std::chrono::milliseconds(iTime));
+#endif
+}
+
+
+void CSystemClock::WaitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const uint64_t iTime)
+{
+  cv.wait_for(lock, std::chrono::milliseconds(iTime));
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <stdint.h>
+
+// Source of time for the mapping engine. All timestamps (tick counts in ms) and waits go through
+// a clock, so retry/back-off/timeout behaviour can also run in simulated time
+class CClock
+{
+  public:
+    virtual ~CClock(void) {};
+
+    virtual uint64_t Now(void) = 0;
+    virtual void Sleep(const uint64_t iTime) = 0;
+
+    // Wait until cv is signalled or iTime ms have passed, lock must be held
+    virtual void WaitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const uint64_t iTime) = 0;
+
+    virtual bool IsVirtual(void) const { return false; };
+};
+
+
+// Wall clock: GetTickCount64/Sleep (steady_clock elsewhere)
+class CSystemClock : public CClock
+{
+  public:
+    uint64_t Now(void);
+    void Sleep(const uint64_t iTime);
+    void WaitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock, const uint64_t iTime);
+};
+
+
+// Simulated time: starts at 0 and only advances when the engine sleeps or waits, which then returns
+// immediately. Nothing can signal a wait in simulated time, so a single thread must drive the run
+class CVirtualClock : public CClock
+{
+  public:
+    uint64_t Now(void) { return m_iNow; };
+    void Sleep(const uint64_t iTime) { m_iNow += iTime; };
+    void WaitFor(std::condition_variable&, std::unique_lock<std::mutex>&, const uint64_t iTime) { m_iNow += iTime; };
+    bool IsVirtual(void) const { return true; };
+
+  private:
+    std::atomic<uint64_t> m_iNow{0};
+};
+
+#endif // CLOCK_H
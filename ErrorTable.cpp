@@ -0,0 +1,114 @@
+#include "ErrorTable.h"
+#include "StringUtils.h"
+
+#include <vector>
+
+// Info from http://msdn.microsoft.com/en-us/library/ms681381.aspx
+const CErrorTable::CEntry CErrorTable::TABLE[] =
+{
+  { ERROR_SUCCESS                       , "OK"                                                     , ERROR_CLASS_SUCCESS     },
+  { ERROR_PATH_NOT_FOUND                , "Path not found (3)"                                     , ERROR_CLASS_TRANSIENT   },
+  { ERROR_ACCESS_DENIED                 , "Access denied (5)"                                      , ERROR_CLASS_CREDENTIALS },
+  { ERROR_BAD_NETPATH                   , "The network path was not found (53)"                    , ERROR_CLASS_HOST_DOWN   }, // Usually the host is down
+  { ERROR_UNEXP_NET_ERR                 , "Unexpected network error (59)"                          , ERROR_CLASS_HOST_DOWN   },
+  { ERROR_NETNAME_DELETED               , "The specified network name is no longer available (64)" , ERROR_CLASS_HOST_DOWN   },
+  { ERROR_NETWORK_ACCESS_DENIED         , "Network access is denied (65)"                          , ERROR_CLASS_CREDENTIALS },
+  { ERROR_BAD_DEV_TYPE                  , "Incorrect network resource (66)"                        , ERROR_CLASS_HOST_DOWN   }, // Occurs when host is unavailable
+  { ERROR_BAD_NET_NAME                  , "Bad network name (67)"                                  , ERROR_CLASS_PERMANENT   }, // Share doesn't exist
+  { ERROR_ALREADY_ASSIGNED              , "Drive already assigned (85)"                            , ERROR_CLASS_SUCCESS     },
+  { ERROR_INVALID_PASSWORD              , "The specified network password is not correct (86)"     , ERROR_CLASS_CREDENTIALS },
+  { ERROR_SEM_TIMEOUT                   , "The semaphore timeout period has expired (121)"         , ERROR_CLASS_HOST_DOWN   }, // SMB session timed out
+  { ERROR_BUSY                          , "The requested resource is busy (170)"                   , ERROR_CLASS_TRANSIENT   },
+  { ERROR_DEVICE_ALREADY_REMEMBERED     , "Local device already in use (1202)"                     , ERROR_CLASS_PERMANENT   },
+  { ERROR_NO_NET_OR_BAD_PATH            , "Network path not found or not available (1203)"        , ERROR_CLASS_HOST_DOWN   },
+  { ERROR_SESSION_CREDENTIAL_CONFLICT   , "Credential conflict (1219)"                             , ERROR_CLASS_PERMANENT   },
+  { ERROR_NO_NETWORK                    , "The network is not present or not started (1222)"      , ERROR_CLASS_TRANSIENT   },
+  { ERROR_CANCELLED                     , "User cancelled (1223)"                                  , ERROR_CLASS_CANCEL      },
+  { ERROR_NETWORK_UNREACHABLE           , "Network unreachable (1231)"                             , ERROR_CLASS_HOST_DOWN   },
+  { ERROR_HOST_UNREACHABLE              , "Host unreachable (1232)"                                , ERROR_CLASS_HOST_DOWN   },
+  { ERROR_PORT_UNREACHABLE              , "Destination port unreachable (1234)"                    , ERROR_CLASS_HOST_DOWN   },
+  { ERROR_LOGON_FAILURE                 , "Bad user name or password (1326)"                       , ERROR_CLASS_CREDENTIALS },
+  { ERROR_CANT_ACCESS_DOMAIN_INFO       , "Cannot access domain info (1351)"                       , ERROR_CLASS_TRANSIENT   },
+  { ERROR_NOT_CONNECTED                 , "Network connection does not exist (2250)"               , ERROR_CLASS_TRANSIENT   },
+};
+
+
+const CErrorTable::CEntry* CErrorTable::Find(const DWORD result)
+{
+  for (size_t i = 0; i < sizeof(TABLE) / sizeof(TABLE[0]); i++)
+  {
+    if (TABLE[i].result == result)
+      return &TABLE[i];
+  }
+
+  return NULL;
+}
+
+
+std::string CErrorTable::Describe(const DWORD result)
+{
+  const CEntry* pEntry = Find(result);
+  if (pEntry)
+    return pEntry->szDescription;
+
+  return "Unknown error (" + std::to_string(result) + ")";
+}
+
+
+// Class of result, unknown codes are considered transient
+EErrorClass CErrorTable::Classify(const DWORD result) const
+{
+  std::map<DWORD, EErrorClass>::const_iterator it = m_mapOverrides.find(result);
+  if (it != m_mapOverrides.end())
+    return it->second;
+
+  const CEntry* pEntry = Find(result);
+  if (pEntry)
+    return pEntry->errorClass;
+
+  return ERROR_CLASS_TRANSIENT;
+}
+
+
+bool CErrorTable::ParseClass(const std::string& strName, EErrorClass& errorClass)
+{
+  if (StringUtils::EqualsNoCase(strName, "success"))
+    errorClass = ERROR_CLASS_SUCCESS;
+  else if (StringUtils::EqualsNoCase(strName, "transient"))
+    errorClass = ERROR_CLASS_TRANSIENT;
+  else if (StringUtils::EqualsNoCase(strName, "host-down"))
+    errorClass = ERROR_CLASS_HOST_DOWN;
+  else if (StringUtils::EqualsNoCase(strName, "permanent"))
+    errorClass = ERROR_CLASS_PERMANENT;
+  else if (StringUtils::EqualsNoCase(strName, "credentials"))
+    errorClass = ERROR_CLASS_CREDENTIALS;
+  else if (StringUtils::EqualsNoCase(strName, "cancel"))
+    errorClass = ERROR_CLASS_CANCEL;
+  else
+    return false;
+
+  return true;
+}
+
+
+// Parse "<code>=<class>[,<code>=<class>...]" overrides
+bool CErrorTable::ParseOverrides(const std::string& strList)
+{
+  const std::vector<std::string> vecItems = StringUtils::Tokenize(strList, ",");
+  if (vecItems.empty())
+    return false;
+
+  for (auto& strItem : vecItems)
+  {
+    std::string strCode, strClass;
+    int32_t iCode;
+    EErrorClass errorClass;
+    if (!StringUtils::Split(StringUtils::Trim(strItem), "=", strCode, strClass) ||
+        !StringUtils::StringToInt32(strCode, iCode) || iCode < 0 || !ParseClass(strClass, errorClass))
+      return false;
+
+    Override((DWORD) iCode, errorClass);
+  }
+
+  return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef ERROR_TABLE_H
+#define ERROR_TABLE_H
+
+#include <string>
+#include <map>
+
+#include <windows.h>
+
+// How the mapping engine treats a connection result
+enum EErrorClass
+{
+  ERROR_CLASS_SUCCESS,                        // Connected (or already connected)
+  ERROR_CLASS_TRANSIENT,                      // Retry later
+  ERROR_CLASS_HOST_DOWN,                      // Transient, and the host itself is unavailable (trips its circuit breaker)
+  ERROR_CLASS_PERMANENT,                      // Retrying won't help, give up on the share
+  ERROR_CLASS_CREDENTIALS,                    // Needs (other) credentials: prompt, don't retry blindly
+  ERROR_CLASS_CANCEL                          // User cancelled
+};
+
+
+// Result codes known to WinMount with their description and class. The built-in table is constant,
+// classes can be overridden per code (eg. from the command line) before mapping starts
+class CErrorTable
+{
+  public:
+    CErrorTable(void) {};   // Constructor (empty)
+    ~CErrorTable(void) {};  // Destructor (empty)
+
+    static std::string Describe(const DWORD result);
+    EErrorClass Classify(const DWORD result) const;
+
+    void Override(const DWORD result, const EErrorClass errorClass) { m_mapOverrides[result] = errorClass; };
+    bool ParseOverrides(const std::string& strList);
+    static bool ParseClass(const std::string& strName, EErrorClass& errorClass);
+
+  private:
+    struct CEntry
+    {
+      DWORD result;
+      const char* szDescription;
+      EErrorClass errorClass;
+    };
+
+    static const CEntry* Find(const DWORD result);
+
+    static const CEntry TABLE[];
+    std::map<DWORD, EErrorClass> m_mapOverrides;
+};
+
+#endif // ERROR_TABLE_H
@@ -0,0 +1,153 @@
+#include "HealthCache.h"
+#include "StringUtils.h"
+
+#include <string.h>
+#include <sddl.h>
+
+#pragma comment(lib, "advapi32.lib")
+
+// Instances of all users on the machine must be able to open and update the mapping
+static const char* MAPPING_SDDL = "D:(A;;GA;;;SY)(A;;GA;;;BA)(A;;GRGW;;;AU)";
+
+CHealthCache::~CHealthCache(void)
+{
+  if (m_pTable)
+    UnmapViewOfFile(m_pTable);
+
+  if (m_hMapping)
+    CloseHandle(m_hMapping);
+}
+
+
+// FNV-1a hash of the (lowercase) host name, never 0 (which marks a free slot)
+LONG CHealthCache::Hash(const std::string& strHost)
+{
+  uint32_t iHash = 2166136261u;
+  for (std::string::const_iterator it = strHost.begin(); it != strHost.end(); ++it)
+  {
+    iHash ^= (uint8_t) *it;
+    iHash *= 16777619u;
+  }
+
+  return iHash ? (LONG) iHash : 1;
+}
+
+
+bool CHealthCache::Open(const std::string& strName)
+{
+  SECURITY_ATTRIBUTES sa;
+  sa.nLength = sizeof(sa);
+  sa.lpSecurityDescriptor = NULL;
+  sa.bInheritHandle = FALSE;
+  if (!ConvertStringSecurityDescriptorToSecurityDescriptorA(MAPPING_SDDL, SDDL_REVISION_1, &sa.lpSecurityDescriptor, NULL))
+    return false;
+
+  // The Global namespace is shared by all (terminal server) sessions, but creating it requires
+  // SeCreateGlobalPrivilege (opening one that exists doesn't), so fall back to the session's Local namespace
+  const char *pszNamespaces[] = { "Global\\", "Local\\" };
+  for (int i = 0; i < 2 && !m_hMapping; i++)
+  {
+    const std::string strMapping = pszNamespaces[i] + strName;
+    m_hMapping = CreateFileMapping(INVALID_HANDLE_VALUE, &sa, PAGE_READWRITE, 0, sizeof(CTable), strMapping.c_str());
+    if (!m_hMapping && GetLastError() == ERROR_ACCESS_DENIED)
+      m_hMapping = OpenFileMapping(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, strMapping.c_str()); // Created by another user
+
+    m_bLocal = (i > 0);
+  }
+
+  LocalFree(sa.lpSecurityDescriptor);
+
+  if (!m_hMapping)
+    return false;
+
+  m_pTable = (CTable *) MapViewOfFile(m_hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(CTable));
+  if (!m_pTable)
+    return false;
+
+  // A new mapping is zero filled, claim it. Refuse a mapping with another layout
+  const LONG lMagic = InterlockedCompareExchange(&m_pTable->lMagic, MAGIC, 0);
+  if (lMagic != 0 && lMagic != MAGIC)
+  {
+    UnmapViewOfFile(m_pTable);
+    m_pTable = NULL;
+    return false;
+  }
+
+  return true;
+}
+
+
+void CHealthCache::Publish(const std::string& strHost, const bool bReachable, const uint64_t iNow)
+{
+  if (!m_pTable || strHost.size() >= MAX_HOST)
+    return;
+
+  const LONG lHash = Hash(strHost);
+  for (int i = 0; i < MAX_PROBE; i++)
+  {
+    CSlot& slot = m_pTable->slots[((uint32_t) lHash + i) % SLOT_COUNT];
+
+    // Claim a free slot, or skip slots of other hosts
+    if (slot.lHash != lHash && InterlockedCompareExchange(&slot.lHash, lHash, 0) != 0 && slot.lHash != lHash)
+      continue;
+
+    // Take the slot for writing, if someone else is updating it just drop our update
+    const LONG lSequence = slot.lSequence;
+    if ((lSequence & 1) || InterlockedCompareExchange(&slot.lSequence, lSequence + 1, lSequence) != lSequence)
+      return;
+
+    if (slot.szHost[0] && strncmp(slot.szHost, strHost.c_str(), MAX_HOST) != 0)
+    {
+      // Hash collision with another host
+      InterlockedExchange(&slot.lSequence, lSequence);
+      continue;
+    }
+
+    strncpy(slot.szHost, strHost.c_str(), MAX_HOST - 1);
+    slot.lReachable = bReachable ? 1 : 0;
+    slot.iUpdated = iNow;
+
+    InterlockedExchange(&slot.lSequence, lSequence + 2); // Publish
+    return;
+  }
+}
+
+
+bool CHealthCache::Lookup(const std::string& strHost, bool& bReachable, uint64_t& iUpdated) const
+{
+  if (!m_pTable)
+    return false;
+
+  const LONG lHash = Hash(strHost);
+  for (int i = 0; i < MAX_PROBE; i++)
+  {
+    CSlot& slot = m_pTable->slots[((uint32_t) lHash + i) % SLOT_COUNT];
+    if (slot.lHash == 0)
+      return false; // End of the probe chain
+    if (slot.lHash != lHash)
+      continue;
+
+    // Consistent snapshot: the sequence must be even and unchanged while copying
+    const LONG lSequence = InterlockedCompareExchange(&slot.lSequence, 0, 0);
+    if (lSequence & 1)
+      return false;
+
+    CSlot copy;
+    memcpy(copy.szHost, slot.szHost, MAX_HOST);
+    copy.lReachable = slot.lReachable;
+    copy.iUpdated = slot.iUpdated;
+
+    if (InterlockedCompareExchange(&slot.lSequence, 0, 0) != lSequence)
+      return false;
+
+    copy.szHost[MAX_HOST - 1] = 0;
+    if (strHost != copy.szHost)
+      continue; // Hash collision with another host
+
+    bReachable = (copy.lReachable != 0);
+    iUpdated = copy.iUpdated;
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+#ifndef HEALTH_CACHE_H
+#define HEALTH_CACHE_H
+
+#include <string>
+#include <stdint.h>
+
+#include <windows.h>
+
+// Host-health cache shared by all WinMount instances on a machine through a named file mapping.
+// Slots are keyed by server name and updated lock-free (a per-slot sequence counter); a torn or
+// contended update is simply skipped, the cache is advisory only. A host is reported down when
+// its breaker opens and up again on any answer from it
+class CHealthCache
+{
+  public:
+    CHealthCache(void) {};  // Constructor (empty)
+    ~CHealthCache(void);    // Destructor (unmaps)
+
+    bool Open(const std::string& strName);
+    bool IsOpen(void) const { return m_pTable != NULL; };
+    bool IsLocal(void) const { return m_bLocal; };  // Only shared with this session (no Global\ mapping)
+
+    void Publish(const std::string& strHost, const bool bReachable, const uint64_t iNow);
+    bool Lookup(const std::string& strHost, bool& bReachable, uint64_t& iUpdated) const;
+
+  private:
+    static const LONG MAGIC = 0x324D4E57;     // "WNM2", change when the layout changes
+    static const int SLOT_COUNT = 256;
+    static const int MAX_PROBE = 8;           // Max. slots probed (open addressing)
+    static const int MAX_HOST = 64;
+
+    struct CSlot
+    {
+      volatile LONG lHash;                    // Hash of the host name (0 = free slot)
+      volatile LONG lSequence;                // Odd while an update is in progress
+      LONG lReachable;
+      uint64_t iUpdated;                      // GetTickCount64() of the last update (machine wide)
+      char szHost[MAX_HOST];
+    };
+
+    struct CTable
+    {
+      volatile LONG lMagic;
+      CSlot slots[SLOT_COUNT];
+    };
+
+    static LONG Hash(const std::string& strHost);
+
+    HANDLE m_hMapping = NULL;
+    CTable* m_pTable = NULL;
+    bool m_bLocal = false;
+};
+
+#endif // HEALTH_CACHE_H
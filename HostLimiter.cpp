@@ -0,0 +1,79 @@
+#include "HostLimiter.h"
+
+#include <algorithm>
+
+void CHostLimiter::SetLimits(const int iMaxTotal, const int iMaxPerHost, const double dRate)
+{
+  m_iMaxTotal = std::max(1, iMaxTotal);
+  m_iMaxPerHost = std::max(1, iMaxPerHost);
+  m_dRate = std::max(0.0, dRate);
+
+  // Allow a burst of one attempt per connection slot
+  m_dBurst = std::max(1.0, (double) m_iMaxPerHost);
+}
+
+
+// Add the tokens accumulated since the last refill for strHost
+CHostLimiter::CHostState& CHostLimiter::Refill(const std::string& strHost, const uint64_t iNow)
+{
+  CHostState& host = m_mapHosts[strHost];
+  if (!host.bInitialized)
+  {
+    host.dTokens = m_dBurst;
+    host.bInitialized = true;
+  }
+  else if (iNow > host.iLastRefill)
+  {
+    host.dTokens = std::min(m_dBurst, host.dTokens + (iNow - host.iLastRefill) * m_dRate / 1000.0);
+  }
+
+  host.iLastRefill = iNow;
+  return host;
+}
+
+
+// Returns true if a connection slot (and a token) is available for strHost
+bool CHostLimiter::CanAcquire(const std::string& strHost, const uint64_t iNow)
+{
+  const CHostState& host = Refill(strHost, iNow);
+
+  if (m_iInFlight >= m_iMaxTotal || host.iInFlight >= m_iMaxPerHost)
+    return false;
+
+  return (m_dRate <= 0.0 || host.dTokens >= 1.0);
+}
+
+
+// Take a connection slot (and a token) for strHost, CanAcquire() must have returned true
+void CHostLimiter::Acquire(const std::string& strHost, const uint64_t iNow)
+{
+  CHostState& host = Refill(strHost, iNow);
+
+  if (m_dRate > 0.0)
+    host.dTokens -= 1.0;
+
+  host.iInFlight++;
+  m_iInFlight++;
+}
+
+
+void CHostLimiter::Release(const std::string& strHost)
+{
+  CHostState& host = m_mapHosts[strHost];
+  if (host.iInFlight > 0)
+  {
+    host.iInFlight--;
+    m_iInFlight--;
+  }
+}
+
+
+// Tick count at which a new token for strHost becomes available (iNow if one is available already)
+uint64_t CHostLimiter::GetNextToken(const std::string& strHost, const uint64_t iNow)
+{
+  const CHostState& host = Refill(strHost, iNow);
+  if (m_dRate <= 0.0 || host.dTokens >= 1.0)
+    return iNow;
+
+  return iNow + (uint64_t) ((1.0 - host.dTokens) * 1000.0 / m_dRate) + 1;
+}
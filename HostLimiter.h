@@ -0,0 +1,44 @@
+#pragma once
+#ifndef HOST_LIMITER_H
+#define HOST_LIMITER_H
+
+#include <string>
+#include <map>
+#include <stdint.h>
+
+// Admission control for connect attempts: a global cap on attempts in flight, a per-host cap and
+// a per-host token bucket limiting the rate of new attempts. Not thread-safe, the caller must lock
+class CHostLimiter
+{
+  public:
+    CHostLimiter(void) {};    // Constructor (empty)
+    ~CHostLimiter(void) {};   // Destructor (empty)
+
+    void SetLimits(const int iMaxTotal, const int iMaxPerHost, const double dRate);
+
+    bool CanAcquire(const std::string& strHost, const uint64_t iNow);
+    void Acquire(const std::string& strHost, const uint64_t iNow);
+    void Release(const std::string& strHost);
+    uint64_t GetNextToken(const std::string& strHost, const uint64_t iNow);
+    int GetInFlight(void) const { return m_iInFlight; };
+
+  private:
+    struct CHostState
+    {
+      int iInFlight = 0;
+      double dTokens = 0.0;
+      uint64_t iLastRefill = 0;
+      bool bInitialized = false;
+    };
+
+    CHostState& Refill(const std::string& strHost, const uint64_t iNow);
+
+    int m_iMaxTotal = 4;                      // Max. attempts in flight in total
+    int m_iMaxPerHost = 2;                    // Max. attempts in flight per host
+    double m_dRate = 0.0;                     // New attempts per second per host (0 = unlimited)
+    double m_dBurst = 1.0;                    // Token bucket size
+    int m_iInFlight = 0;
+    std::map<std::string, CHostState> m_mapHosts;
+};
+
+#endif // HOST_LIMITER_H
@@ -0,0 +1,305 @@
+#include <winsock2.h> // Must come before windows.h
+#include <ws2tcpip.h>
+
+#include "Metrics.h"
+
+#include <map>
+#include <fstream>
+#include <string.h> // For memset
+
+#pragma comment(lib, "ws2_32.lib")
+
+// Upper bounds in ms of the histogram buckets (the last one is +Inf)
+static const uint64_t BUCKET_BOUNDS[] = { 100, 250, 500, 1000, 2500, 5000, 10000, 30000, 60000 };
+
+
+// Instances ever created
+static std::atomic<uint64_t> g_iGenerations{0};
+
+
+CMetrics::CMetrics(void) : m_iGeneration(++g_iGenerations)
+{
+}
+
+
+CMetrics::~CMetrics(void)
+{
+  StopServer();
+
+  for (auto pBlock : m_vecBlocks)
+    delete pBlock;
+}
+
+
+// Counter block of the calling thread, created on first use. The cache is keyed on the generation of the
+// instance: a new instance at the address of a destroyed one must not use its (freed) block
+CMetrics::CBlock& CMetrics::GetBlock(void)
+{
+  static thread_local uint64_t t_iOwner = 0;
+  static thread_local CBlock* t_pBlock = NULL;
+
+  if (t_iOwner != m_iGeneration)
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    t_pBlock = new CBlock();
+    m_vecBlocks.push_back(t_pBlock);
+    t_iOwner = m_iGeneration;
+  }
+
+  return *t_pBlock;
+}
+
+
+void CMetrics::Observe(CHistogram& histogram, const uint64_t iValue)
+{
+  int iBucket = 0;
+  while (iBucket < BUCKETS - 1 && iValue > BUCKET_BOUNDS[iBucket])
+    iBucket++;
+
+  histogram.buckets[iBucket].fetch_add(1, std::memory_order_relaxed);
+  histogram.iSum.fetch_add(iValue, std::memory_order_relaxed);
+  histogram.iCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void CMetrics::CountAttempt(const uint32_t iResult, const uint64_t iLatency)
+{
+  if (!m_bEnabled)
+    return;
+
+  CBlock& block = GetBlock();
+  Observe(block.latency, iLatency);
+
+  // Slots hold result + 1 (0 = free), only this thread writes them
+  int iSlot = 0;
+  for (; iSlot < RESULT_SLOTS - 1; iSlot++)
+  {
+    const uint32_t iStored = block.results[iSlot].load(std::memory_order_relaxed);
+    if (iStored == iResult + 1)
+      break;
+
+    if (iStored == 0)
+    {
+      block.results[iSlot].store(iResult + 1, std::memory_order_release);
+      break;
+    }
+  }
+
+  block.resultCounts[iSlot].fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void CMetrics::CountRetry(void)
+{
+  if (m_bEnabled)
+    GetBlock().iRetries.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void CMetrics::CountBreakerTrip(void)
+{
+  if (m_bEnabled)
+    GetBlock().iBreakerTrips.fetch_add(1, std::memory_order_relaxed);
+}
+
+
+void CMetrics::ObserveTimeToMapped(const uint64_t iTime)
+{
+  if (m_bEnabled)
+    Observe(GetBlock().timeToMapped, iTime);
+}
+
+
+void CMetrics::SetDrives(const int iMapped, const int iUnmapped)
+{
+  m_iMapped.store(iMapped, std::memory_order_relaxed);
+  m_iUnmapped.store(iUnmapped, std::memory_order_relaxed);
+}
+
+
+void CMetrics::ExportHistogram(std::string& strOut, const std::string& strName, const std::string& strHelp, const std::vector<const CHistogram*>& vecHistograms)
+{
+  uint64_t buckets[BUCKETS] = { 0 };
+  uint64_t iSum = 0, iCount = 0;
+
+  for (auto pHistogram : vecHistograms)
+  {
+    for (int i = 0; i < BUCKETS; i++)
+      buckets[i] += pHistogram->buckets[i].load(std::memory_order_relaxed);
+
+    iSum += pHistogram->iSum.load(std::memory_order_relaxed);
+    iCount += pHistogram->iCount.load(std::memory_order_relaxed);
+  }
+
+  strOut += "# HELP " + strName + " " + strHelp + "\n";
+  strOut += "# TYPE " + strName + " histogram\n";
+
+  uint64_t iCumulative = 0;
+  for (int i = 0; i < BUCKETS; i++)
+  {
+    iCumulative += buckets[i];
+    const std::string strBound = (i < BUCKETS - 1) ? std::to_string(BUCKET_BOUNDS[i] / 1000.0) : "+Inf";
+    strOut += strName + "_bucket{le=\"" + strBound + "\"} " + std::to_string(iCumulative) + "\n";
+  }
+
+  strOut += strName + "_sum " + std::to_string(iSum / 1000.0) + "\n";
+  strOut += strName + "_count " + std::to_string(iCount) + "\n";
+}
+
+
+// All metrics in Prometheus text exposition format
+std::string CMetrics::Export(void)
+{
+  std::map<uint32_t, uint64_t> mapResults;
+  uint64_t iRetries = 0, iBreakerTrips = 0, iOther = 0;
+  std::vector<const CHistogram*> vecLatency, vecTimeToMapped;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto pBlock : m_vecBlocks)
+    {
+      for (int i = 0; i < RESULT_SLOTS - 1; i++)
+      {
+        const uint32_t iStored = pBlock->results[i].load(std::memory_order_acquire);
+        if (iStored)
+          mapResults[iStored - 1] += pBlock->resultCounts[i].load(std::memory_order_relaxed);
+      }
+      iOther += pBlock->resultCounts[RESULT_SLOTS - 1].load(std::memory_order_relaxed);
+
+      iRetries += pBlock->iRetries.load(std::memory_order_relaxed);
+      iBreakerTrips += pBlock->iBreakerTrips.load(std::memory_order_relaxed);
+      vecLatency.push_back(&pBlock->latency);
+      vecTimeToMapped.push_back(&pBlock->timeToMapped);
+    }
+  }
+
+  std::string strOut;
+  strOut += "# HELP winmount_connect_attempts_total Connect attempts by result code.\n";
+  strOut += "# TYPE winmount_connect_attempts_total counter\n";
+  for (auto& result : mapResults)
+    strOut += "winmount_connect_attempts_total{result=\"" + std::to_string(result.first) + "\"} " + std::to_string(result.second) + "\n";
+  if (iOther)
+    strOut += "winmount_connect_attempts_total{result=\"other\"} " + std::to_string(iOther) + "\n";
+
+  ExportHistogram(strOut, "winmount_connect_latency_seconds", "Latency of connect attempts.", vecLatency);
+  ExportHistogram(strOut, "winmount_time_to_mapped_seconds", "Time from the start of the run until a drive was mapped.", vecTimeToMapped);
+
+  strOut += "# HELP winmount_retries_total Connect attempts rescheduled after a failure.\n";
+  strOut += "# TYPE winmount_retries_total counter\n";
+  strOut += "winmount_retries_total " + std::to_string(iRetries) + "\n";
+  strOut += "# HELP winmount_breaker_trips_total Times a host circuit breaker opened.\n";
+  strOut += "# TYPE winmount_breaker_trips_total counter\n";
+  strOut += "winmount_breaker_trips_total " + std::to_string(iBreakerTrips) + "\n";
+  strOut += "# HELP winmount_drives Drives by state.\n";
+  strOut += "# TYPE winmount_drives gauge\n";
+  strOut += "winmount_drives{state=\"mapped\"} " + std::to_string(m_iMapped.load()) + "\n";
+  strOut += "winmount_drives{state=\"unmapped\"} " + std::to_string(m_iUnmapped.load()) + "\n";
+
+  return strOut;
+}
+
+
+// Write the metrics to strFile (through a temporary file, so readers never see a partial file)
+bool CMetrics::WriteFile(const std::string& strFile)
+{
+  const std::string strTemp = strFile + ".tmp";
+  {
+    std::ofstream fStream(strTemp, std::ios::out | std::ios::trunc);
+    if (!fStream.is_open())
+      return false;
+
+    fStream << Export();
+    if (fStream.fail())
+      return false;
+  }
+
+  return MoveFileEx(strTemp.c_str(), strFile.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+
+// Serve the metrics over HTTP on localhost:iPort
+bool CMetrics::StartServer(const int iPort)
+{
+  WSADATA wsaData;
+  if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    return false;
+
+  SOCKET sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (sock == INVALID_SOCKET)
+  {
+    WSACleanup();
+    return false;
+  }
+
+  // Don't share the port with (or let it be taken over by) another process
+  const BOOL bExclusive = TRUE;
+  setsockopt(sock, SOL_SOCKET, SO_EXCLUSIVEADDRUSE, (const char *) &bExclusive, sizeof(bExclusive));
+
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never expose outside this machine
+  addr.sin_port = htons((u_short) iPort);
+
+  if (bind(sock, (struct sockaddr *) &addr, sizeof(addr)) != 0 || listen(sock, SOMAXCONN) != 0)
+  {
+    closesocket(sock);
+    WSACleanup();
+    return false;
+  }
+
+  m_socket = (uintptr_t) sock;
+  m_bStopServer = false;
+  m_server = std::thread(&CMetrics::ServerThread, this);
+
+  return true;
+}
+
+
+void CMetrics::StopServer(void)
+{
+  if (!m_server.joinable())
+    return;
+
+  m_bStopServer = true;
+  m_server.join();
+
+  closesocket((SOCKET) m_socket);
+  WSACleanup();
+}
+
+
+void CMetrics::ServerThread(void)
+{
+  const SOCKET sock = (SOCKET) m_socket;
+
+  while (!m_bStopServer)
+  {
+    // Poll so we notice StopServer()
+    fd_set fds;
+    FD_ZERO(&fds);
+    FD_SET(sock, &fds);
+    struct timeval tv = { 0, 250000 };
+    if (select((int) sock + 1, &fds, NULL, NULL, &tv) <= 0)
+      continue;
+
+    const SOCKET client = accept(sock, NULL, NULL);
+    if (client == INVALID_SOCKET)
+      continue;
+
+    // A client that doesn't send its request (or read the answer) must not hold up StopServer()
+    const DWORD dwTimeout = 1000;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, (const char *) &dwTimeout, sizeof(dwTimeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, (const char *) &dwTimeout, sizeof(dwTimeout));
+
+    // Whatever was requested, answer with the metrics
+    char szRequest[1024];
+    recv(client, szRequest, sizeof(szRequest), 0);
+
+    const std::string strBody = Export();
+    const std::string strResponse = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " +
+                                    std::to_string(strBody.size()) + "\r\nConnection: close\r\n\r\n" + strBody;
+    send(client, strResponse.c_str(), (int) strResponse.size(), 0);
+    closesocket(client);
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <stdint.h>
+
+// Counters and histograms of a mapping run in Prometheus text format. Each thread updates its own
+// counter block (relaxed atomics, no locks or shared cache lines on the mapping path); exports sum
+// the blocks of all threads
+class CMetrics
+{
+  public:
+    CMetrics(void);       // Constructor
+    ~CMetrics(void);      // Destructor (stops the server)
+
+    void Enable(void) { m_bEnabled = true; };
+    bool IsEnabled(void) const { return m_bEnabled; };
+
+    void CountAttempt(const uint32_t iResult, const uint64_t iLatency);
+    void CountRetry(void);
+    void CountBreakerTrip(void);
+    void ObserveTimeToMapped(const uint64_t iTime);
+    void SetDrives(const int iMapped, const int iUnmapped);
+
+    std::string Export(void);
+    bool WriteFile(const std::string& strFile);
+    bool StartServer(const int iPort);
+    void StopServer(void);
+
+  private:
+    static const int RESULT_SLOTS = 32;       // Distinct result codes per thread (last slot = other)
+    static const int BUCKETS = 10;            // Histogram buckets (last = +Inf)
+
+    struct CHistogram
+    {
+      std::atomic<uint64_t> buckets[BUCKETS];
+      std::atomic<uint64_t> iSum;             // In ms
+      std::atomic<uint64_t> iCount;
+    };
+
+    // Counters owned (written) by a single thread
+    struct CBlock
+    {
+      std::atomic<uint32_t> results[RESULT_SLOTS];
+      std::atomic<uint64_t> resultCounts[RESULT_SLOTS];
+      std::atomic<uint64_t> iRetries;
+      std::atomic<uint64_t> iBreakerTrips;
+      CHistogram latency;
+      CHistogram timeToMapped;
+    };
+
+    CBlock& GetBlock(void);
+    static void Observe(CHistogram& histogram, const uint64_t iValue);
+    static void ExportHistogram(std::string& strOut, const std::string& strName, const std::string& strHelp, const std::vector<const CHistogram*>& vecHistograms);
+    void ServerThread(void);
+
+    bool m_bEnabled = false;
+    const uint64_t m_iGeneration;             // Unique per instance (unlike its address), keys the cached block of a thread
+    std::mutex m_mutex;                       // Protects m_vecBlocks (only taken once per thread)
+    std::vector<CBlock*> m_vecBlocks;
+    std::atomic<int> m_iMapped{0};
+    std::atomic<int> m_iUnmapped{0};
+
+    std::thread m_server;
+    std::atomic<bool> m_bStopServer{false};
+    uintptr_t m_socket = ~(uintptr_t) 0;
+};
+
+#endif // METRICS_H
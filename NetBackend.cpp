@@ -0,0 +1,198 @@
+#include "NetBackend.h"
+#include "StringUtils.h"
+
+#include <iostream> // For std::cout
+#include <chrono>
+
+// Milliseconds on a monotonic clock
+static uint64_t NowMs(void)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+bool CRecordingBackend::Open(const std::string& strFile)
+{
+  m_fStream.open(strFile, std::ios::out | std::ios::trunc);
+  if (!m_fStream.is_open())
+    return false;
+
+  m_iStart = NowMs();
+  m_fStream << "# WinMount record 1" << std::endl;
+
+  return true;
+}
+
+
+// Make sure a replay always has a baseline, also when mapping never finished
+CRecordingBackend::~CRecordingBackend(void)
+{
+  if (m_fStream.is_open() && !m_bFinished)
+    Finish(false, NowMs() - m_iStart);
+}
+
+
+NetResult CRecordingBackend::AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags)
+{
+  const uint64_t iStart = NowMs();
+  const NetResult result = m_pBackend->AddConnection(strLocal, strRemote, iFlags);
+  Record((iFlags & NET_CONNECT_INTERACTIVE) ? 'I' : 'A', iStart, iFlags, result, strLocal, strRemote);
+
+  return result;
+}
+
+
+NetResult CRecordingBackend::CancelConnection(const std::string& strLocal)
+{
+  const uint64_t iStart = NowMs();
+  const NetResult result = m_pBackend->CancelConnection(strLocal);
+  Record('C', iStart, 0, result, strLocal, "-");
+
+  return result;
+}
+
+
+void CRecordingBackend::Finish(const bool bAllMapped, const uint64_t iElapsed)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_bFinished = true;
+  m_fStream << "# result " << (bAllMapped ? "mapped " : "unmapped ") << iElapsed << std::endl;
+}
+
+
+void CRecordingBackend::RecordResolve(const std::string& strHost, const uint64_t iStart, const bool bResolved)
+{
+  Record('R', iStart, 0, bResolved ? NET_RESULT_OK : NET_RESULT_HOST_NOT_FOUND, "-", strHost);
+}
+
+
+void CRecordingBackend::Record(const char cOp, const uint64_t iStart, const uint32_t iFlags, const NetResult result, const std::string& strLocal, const std::string& strRemote)
+{
+  const uint64_t iEnd = NowMs();
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_fStream << cOp << '\t' << (iStart - m_iStart) << '\t' << (iEnd - iStart) << '\t' << iFlags << '\t' << result
+            << '\t' << strLocal << '\t' << strRemote << '\n';
+}
+
+
+bool CReplayBackend::Open(const std::string& strFile)
+{
+  std::ifstream fStream(strFile, std::ios::in);
+  if (!fStream.is_open())
+    return false;
+
+  std::string strLine;
+  while (std::getline(fStream, strLine))
+  {
+    std::vector<std::string> vecFields = StringUtils::Tokenize(StringUtils::TrimRight(strLine), "\t");
+
+    if (StringUtils::StartsWith(strLine, "# result "))
+    {
+      vecFields = StringUtils::Tokenize(strLine, " ");
+      int32_t iBaseline;
+      if (vecFields.size() != 4 || !StringUtils::StringToInt32(vecFields[3], iBaseline))
+        return false;
+
+      m_bBaseline = true;
+      m_bBaselineMapped = (vecFields[2] == "mapped");
+      m_iBaseline = iBaseline;
+    }
+    else if (strLine.size() && strLine[0] != '#')
+    {
+      int32_t iLatency, iResult;
+      if (vecFields.size() != 7 || !StringUtils::StringToInt32(vecFields[2], iLatency) || !StringUtils::StringToInt32(vecFields[4], iResult))
+        return false;
+
+      CCall call;
+      call.result = (NetResult) iResult;
+      call.iLatency = (uint32_t) iLatency;
+      m_mapCalls[vecFields[0] + " " + vecFields[5] + " " + vecFields[6]].vecCalls.push_back(call);
+    }
+  }
+
+  return true;
+}
+
+
+// Return the next recorded result for strKey after its recorded latency. When the engine makes more calls
+// than were recorded, the last recorded call is repeated
+NetResult CReplayBackend::Replay(const std::string& strKey)
+{
+  CCall call;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::map<std::string, CCallQueue>::iterator it = m_mapCalls.find(strKey);
+    if (it == m_mapCalls.end())
+    {
+      m_iUnmatched++;
+      return NET_RESULT_BAD_NET_NAME;
+    }
+
+    CCallQueue& queue = it->second;
+    call = queue.vecCalls[queue.iNext];
+    if (queue.iNext + 1 < queue.vecCalls.size())
+      queue.iNext++;
+  }
+
+  m_clock.Sleep(call.iLatency);
+
+  return call.result;
+}
+
+
+NetResult CReplayBackend::AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags)
+{
+  return Replay(std::string((iFlags & NET_CONNECT_INTERACTIVE) ? "I " : "A ") + strLocal + " " + strRemote);
+}
+
+
+NetResult CReplayBackend::CancelConnection(const std::string& strLocal)
+{
+  return Replay("C " + strLocal + " -");
+}
+
+
+// Replay the next recorded resolution of strHost. Hosts that weren't resolved in the recorded run
+// (eg. pre-resolution was disabled) resolve
+bool CReplayBackend::ReplayResolve(const std::string& strHost)
+{
+  const std::string strKey = "R - " + strHost;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_mapCalls.count(strKey))
+      return true;
+  }
+
+  return Replay(strKey) == NET_RESULT_OK;
+}
+
+
+void CReplayBackend::Finish(const bool bAllMapped, const uint64_t iElapsed)
+{
+  std::cout << "Replay: " << (bAllMapped ? "all mapped" : "NOT all mapped") << " after " << iElapsed << " ms, ";
+  if (m_bBaseline)
+  {
+    std::cout << "recorded baseline: " << (m_bBaselineMapped ? "all mapped" : "NOT all mapped") << " after " << m_iBaseline << " ms ("
+              << (iElapsed >= m_iBaseline ? "+" : "-") << (iElapsed >= m_iBaseline ? iElapsed - m_iBaseline : m_iBaseline - iElapsed) << " ms)" << std::endl;
+  }
+  else
+  {
+    std::cout << "no recorded baseline (incomplete recording)" << std::endl;
+  }
+
+  if (m_iUnmatched)
+    std::cout << "Replay: " << m_iUnmatched << " call(s) not found in the recording" << std::endl;
+}
+
+
+bool CRecordingResolver::Resolve(const std::string& strHost)
+{
+  const uint64_t iStart = NowMs();
+  const bool bResolved = m_pResolver->Resolve(strHost);
+  m_recorder.RecordResolve(strHost, iStart, bResolved);
+
+  return bResolved;
+}
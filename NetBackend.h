@@ -0,0 +1,144 @@
+#pragma once
+#ifndef NET_BACKEND_H
+#define NET_BACKEND_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include <stdint.h>
+
+#include "Clock.h"
+#include "Resolver.h"
+
+// Backends, recordings and replays don't depend on platform headers, so a recording can be replayed
+// anywhere. Flag and result values are the Win32 ones (CONNECT_* and ERROR_* codes)
+typedef uint32_t NetResult;
+
+enum
+{
+  NET_CONNECT_UPDATE_PROFILE = 0x00000001,
+  NET_CONNECT_INTERACTIVE    = 0x00000008,
+  NET_CONNECT_PROMPT         = 0x00000010
+};
+
+const NetResult NET_RESULT_OK = 0;
+const NetResult NET_RESULT_BAD_NET_NAME = 67;
+const NetResult NET_RESULT_HOST_NOT_FOUND = 11001;  // WSAHOST_NOT_FOUND, a failed name resolution
+
+
+// Connection backend used by the mapping engine
+class CNetBackend
+{
+  public:
+    virtual ~CNetBackend(void) {};
+
+    virtual NetResult AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags) = 0;
+    virtual NetResult CancelConnection(const std::string& strLocal) = 0;
+
+    // Called once when mapping has finished (or was cancelled), with the time it took in ms
+    virtual void Finish(const bool bAllMapped, const uint64_t iElapsed) {};
+};
+
+
+// Passes calls through to another backend and records each call, its result and its latency
+//
+// Record file format (tab separated, one call per line):
+//   <op> <time ms> <latency ms> <flags> <result> <local> <remote>
+// where op is A (add), I (interactive add), C (cancel) or R (name resolution of the host in <remote>, local is "-"
+// and result 0 or NET_RESULT_HOST_NOT_FOUND), followed by a final "# result <mapped|unmapped> <ms>" line
+class CRecordingBackend : public CNetBackend
+{
+  public:
+    CRecordingBackend(CNetBackend* pBackend) : m_pBackend(pBackend) {};
+    ~CRecordingBackend(void);  // Destructor (ends an unfinished recording as unmapped)
+
+    bool Open(const std::string& strFile);
+
+    NetResult AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags);
+    NetResult CancelConnection(const std::string& strLocal);
+    void Finish(const bool bAllMapped, const uint64_t iElapsed);
+    void RecordResolve(const std::string& strHost, const uint64_t iStart, const bool bResolved);
+
+  private:
+    void Record(const char cOp, const uint64_t iStart, const uint32_t iFlags, const NetResult result, const std::string& strLocal, const std::string& strRemote);
+
+    std::unique_ptr<CNetBackend> m_pBackend;
+    std::ofstream m_fStream;
+    std::mutex m_mutex;
+    uint64_t m_iStart = 0;
+    bool m_bFinished = false;
+};
+
+
+// Simulated backend feeding a recorded run back to the mapping engine
+class CReplayBackend : public CNetBackend
+{
+  public:
+    CReplayBackend(CClock& clock) : m_clock(clock) {};
+    ~CReplayBackend(void) {};
+
+    bool Open(const std::string& strFile);
+
+    NetResult AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags);
+    NetResult CancelConnection(const std::string& strLocal);
+    void Finish(const bool bAllMapped, const uint64_t iElapsed);
+    bool ReplayResolve(const std::string& strHost);
+
+  private:
+    struct CCall
+    {
+      NetResult result;
+      uint32_t iLatency;
+    };
+
+    // Recorded calls per "<op> <local> <remote>", in order
+    struct CCallQueue
+    {
+      std::vector<CCall> vecCalls;
+      size_t iNext = 0;
+    };
+
+    NetResult Replay(const std::string& strKey);
+
+    CClock& m_clock;                          // Recorded latencies are spent on this clock
+    std::map<std::string, CCallQueue> m_mapCalls;
+    std::mutex m_mutex;
+    bool m_bBaseline = false;                 // The recording has a "# result" line
+    bool m_bBaselineMapped = false;
+    uint64_t m_iBaseline = 0;                 // Recorded time to finish mapping in ms
+    size_t m_iUnmatched = 0;                  // Calls that were not in the recording
+};
+
+
+// Passes name resolutions through to another resolver and records them in the file of a recording backend
+class CRecordingResolver : public CResolver
+{
+  public:
+    CRecordingResolver(CResolver* pResolver, CRecordingBackend& recorder) : m_pResolver(pResolver), m_recorder(recorder) {};
+    ~CRecordingResolver(void) {};
+
+    bool Resolve(const std::string& strHost);
+
+  private:
+    std::unique_ptr<CResolver> m_pResolver;
+    CRecordingBackend& m_recorder;
+};
+
+
+// Feeds the name resolutions recorded with the calls back to the mapping engine
+class CReplayResolver : public CResolver
+{
+  public:
+    CReplayResolver(CReplayBackend& replay) : m_replay(replay) {};
+    ~CReplayResolver(void) {};
+
+    bool Resolve(const std::string& strHost) { return m_replay.ReplayResolve(strHost); };
+
+  private:
+    CReplayBackend& m_replay;
+};
+
+#endif // NET_BACKEND_H
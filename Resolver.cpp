@@ -0,0 +1,130 @@
+#include <winsock2.h> // Must come before windows.h
+#include <ws2tcpip.h>
+
+#include "Resolver.h"
+#include "StringUtils.h"
+
+#include <fstream>
+#include <vector>
+#include <string.h> // For memset
+
+#pragma comment(lib, "ws2_32.lib")
+
+CSystemResolver::CSystemResolver(void)
+{
+  WSADATA wsaData;
+  m_bStarted = (WSAStartup(MAKEWORD(2, 2), &wsaData) == 0);
+}
+
+
+CSystemResolver::~CSystemResolver(void)
+{
+  if (m_bStarted)
+    WSACleanup();
+}
+
+
+bool CSystemResolver::Resolve(const std::string& strHost)
+{
+  if (!m_bStarted)
+    return true; // Can't tell, let WNetAddConnection2 find out
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  struct addrinfo *pResult = NULL;
+  if (getaddrinfo(strHost.c_str(), NULL, &hints, &pResult) != 0)
+    return false;
+
+  freeaddrinfo(pResult);
+  return true;
+}
+
+
+bool CStaticResolver::Open(const std::string& strFile)
+{
+  std::ifstream fStream(strFile, std::ios::in);
+  if (!fStream.is_open())
+    return false;
+
+  std::string strLine;
+  while (std::getline(fStream, strLine))
+  {
+    const std::vector<std::string> vecFields = StringUtils::Tokenize(StringUtils::Trim(strLine), " \t");
+    if (!vecFields.size() || vecFields[0][0] == ';' || vecFields[0][0] == '#')
+      continue;
+
+    CEntry entry;
+    int32_t iLatency = 0;
+    if (vecFields.size() < 2 || vecFields.size() > 3 || (vecFields.size() == 3 && !StringUtils::StringToInt32(vecFields[2], iLatency)))
+      return false;
+
+    entry.bResolves = StringUtils::EqualsNoCase(vecFields[1], "ok");
+    entry.iLatency = (uint32_t) iLatency;
+    m_mapHosts[StringUtils::ToLower(vecFields[0])] = entry;
+  }
+
+  return true;
+}
+
+
+bool CStaticResolver::Resolve(const std::string& strHost)
+{
+  std::map<std::string, CEntry>::const_iterator it = m_mapHosts.find(strHost);
+  if (it == m_mapHosts.end())
+    return true;
+
+  if (it->second.iLatency)
+    m_clock.Sleep(it->second.iLatency);
+
+  return it->second.bResolves;
+}
+
+
+void CNameCache::SetResolver(CResolver* pResolver, CClock& clock, const uint64_t iTtl, const uint64_t iNegativeTtl)
+{
+  m_pResolver.reset(pResolver);
+  m_pClock = &clock;
+  m_iTtl = iTtl;
+  m_iNegativeTtl = iNegativeTtl;
+}
+
+
+// Resolve strHost (unless a valid cached result exists) and return whether it resolves
+bool CNameCache::Resolve(const std::string& strHost)
+{
+  if (!m_pResolver)
+    return true;
+
+  const EState state = Lookup(strHost, m_pClock->Now());
+  if (state != STATE_UNKNOWN)
+    return (state == STATE_RESOLVED);
+
+  // Don't hold the lock while resolving, hosts are resolved concurrently
+  const bool bResolved = m_pResolver->Resolve(strHost);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  CEntry& entry = m_mapEntries[strHost];
+  entry.bResolved = bResolved;
+  entry.iExpires = m_pClock->Now() + (bResolved ? m_iTtl : m_iNegativeTtl);
+
+  return bResolved;
+}
+
+
+// Cached state of strHost (and when it expires), STATE_UNKNOWN if not (or no longer) cached
+CNameCache::EState CNameCache::Lookup(const std::string& strHost, const uint64_t iNow, uint64_t* piExpires /* = NULL */)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  std::map<std::string, CEntry>::const_iterator it = m_mapEntries.find(strHost);
+  if (it == m_mapEntries.end() || it->second.iExpires <= iNow)
+    return STATE_UNKNOWN;
+
+  if (piExpires)
+    *piExpires = it->second.iExpires;
+
+  return it->second.bResolved ? STATE_RESOLVED : STATE_FAILED;
+}
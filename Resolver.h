@@ -0,0 +1,92 @@
+#pragma once
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <string>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <stdint.h>
+
+#include "Clock.h"
+
+// Name resolver, pluggable so resolution can be simulated
+class CResolver
+{
+  public:
+    virtual ~CResolver(void) {};
+
+    // Returns true if strHost resolves to at least one address
+    virtual bool Resolve(const std::string& strHost) = 0;
+};
+
+
+// Resolve through the system resolver (getaddrinfo), this also warms the OS resolver cache
+// used by WNetAddConnection2 itself
+class CSystemResolver : public CResolver
+{
+  public:
+    CSystemResolver(void);
+    ~CSystemResolver(void);
+
+    bool Resolve(const std::string& strHost);
+
+  private:
+    bool m_bStarted;
+};
+
+
+// Resolve from a file with "<host> <ok|fail> [latency ms]" lines (for simulations/testing).
+// Hosts not in the file resolve successfully
+class CStaticResolver : public CResolver
+{
+  public:
+    CStaticResolver(CClock& clock) : m_clock(clock) {};
+    ~CStaticResolver(void) {};
+
+    bool Open(const std::string& strFile);
+    bool Resolve(const std::string& strHost);
+
+  private:
+    struct CEntry
+    {
+      bool bResolves;
+      uint32_t iLatency;
+    };
+
+    CClock& m_clock;                          // Simulated latencies are spent on this clock
+    std::map<std::string, CEntry> m_mapHosts;
+};
+
+
+// Per-run cache of resolver results (including failures), each with its own TTL. Thread-safe
+class CNameCache
+{
+  public:
+    enum EState { STATE_UNKNOWN, STATE_RESOLVED, STATE_FAILED };
+
+    CNameCache(void) {};
+    ~CNameCache(void) {};
+
+    void SetResolver(CResolver* pResolver, CClock& clock, const uint64_t iTtl, const uint64_t iNegativeTtl);
+    bool IsEnabled(void) const { return m_pResolver != NULL; };
+
+    bool Resolve(const std::string& strHost);
+    EState Lookup(const std::string& strHost, const uint64_t iNow, uint64_t* piExpires = NULL);
+
+  private:
+    struct CEntry
+    {
+      bool bResolved;
+      uint64_t iExpires;
+    };
+
+    std::unique_ptr<CResolver> m_pResolver;
+    CClock* m_pClock = NULL;                  // TTLs start when a lookup completes
+    uint64_t m_iTtl = 0;
+    uint64_t m_iNegativeTtl = 0;
+    std::map<std::string, CEntry> m_mapEntries;
+    std::mutex m_mutex;
+};
+
+#endif // RESOLVER_H
@@ -0,0 +1,157 @@
+#include "TraceLog.h"
+
+#include <windows.h> // For GetCurrentProcessId/GetCurrentThreadId
+
+// Escape a string for use in JSON (UNC paths are full of backslashes). Other control characters and
+// non-ASCII bytes (mount files are in the ANSI code page, not UTF-8) become \u00XX
+static std::string JsonEscape(const std::string& str)
+{
+  static const char* szHex = "0123456789abcdef";
+
+  std::string strResult;
+  for (std::string::const_iterator it = str.begin(); it != str.end(); ++it)
+  {
+    const unsigned char c = (unsigned char) *it;
+    switch (c)
+    {
+      case '\\' : strResult += "\\\\"; break;
+      case '"'  : strResult += "\\\""; break;
+      case '\n' : strResult += "\\n"; break;
+      case '\r' : strResult += "\\r"; break;
+      case '\t' : strResult += "\\t"; break;
+      default   :
+        if (c < 0x20 || c >= 0x7F)
+        {
+          strResult += "\\u00";
+          strResult += szHex[c >> 4];
+          strResult += szHex[c & 0xF];
+        }
+        else
+        {
+          strResult += (char) c;
+        }
+    }
+  }
+
+  return strResult;
+}
+
+
+CTraceLog::~CTraceLog(void)
+{
+  Close();
+}
+
+
+bool CTraceLog::Open(const std::string& strFile)
+{
+  m_fStream.open(strFile, std::ios::out | std::ios::trunc);
+  if (!m_fStream.is_open())
+    return false;
+
+  m_start = std::chrono::steady_clock::now();
+  m_bFirstEvent = true;
+  m_fStream << "[";
+
+  return true;
+}
+
+
+void CTraceLog::Close(void)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_fStream.is_open())
+  {
+    m_fStream << "\n]\n";
+    m_fStream.close();
+  }
+}
+
+
+void CTraceLog::SetClock(CClock* pClock)
+{
+  m_pClock = pClock;
+  m_iClockStart = pClock->Now();
+}
+
+
+uint64_t CTraceLog::Now(void) const
+{
+  if (m_pClock)
+    return (m_pClock->Now() - m_iClockStart) * 1000;
+
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - m_start).count();
+}
+
+
+// Add a complete ("X") event
+void CTraceLog::AddSpan(const std::string& strName, const std::string& strCategory, const uint64_t iStart, const uint64_t iEnd,
+                        const std::vector<std::pair<std::string, std::string> >& vecArgs)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  WriteEvent(strName, strCategory, "X", iStart, ",\"dur\":" + std::to_string(iEnd - iStart), vecArgs);
+}
+
+
+// Add an async begin/end ("b"/"e") event pair
+void CTraceLog::AddAsyncSpan(const std::string& strName, const std::string& strCategory, const uint64_t iId, const uint64_t iStart, const uint64_t iEnd,
+                             const std::vector<std::pair<std::string, std::string> >& vecArgs)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  const std::string strId = ",\"id\":" + std::to_string(iId);
+  WriteEvent(strName, strCategory, "b", iStart, strId, vecArgs);
+  WriteEvent(strName, strCategory, "e", iEnd, strId, std::vector<std::pair<std::string, std::string> >());
+}
+
+
+// Write a single event, m_mutex must be held
+void CTraceLog::WriteEvent(const std::string& strName, const std::string& strCategory, const char* szPhase, const uint64_t iTime,
+                           const std::string& strExtra, const std::vector<std::pair<std::string, std::string> >& vecArgs)
+{
+  if (!m_fStream.is_open())
+    return;
+
+  m_fStream << (m_bFirstEvent ? "\n" : ",\n");
+  m_bFirstEvent = false;
+
+  m_fStream << "{\"name\":\"" << JsonEscape(strName) << "\",\"cat\":\"" << JsonEscape(strCategory) << "\",\"ph\":\"" << szPhase << "\""
+            << ",\"ts\":" << iTime << strExtra
+            << ",\"pid\":" << GetCurrentProcessId() << ",\"tid\":" << GetCurrentThreadId();
+
+  if (vecArgs.size())
+  {
+    m_fStream << ",\"args\":{";
+    for (size_t i = 0; i < vecArgs.size(); i++)
+    {
+      m_fStream << (i ? "," : "") << "\"" << JsonEscape(vecArgs[i].first) << "\":\"" << JsonEscape(vecArgs[i].second) << "\"";
+    }
+    m_fStream << "}";
+  }
+
+  m_fStream << "}";
+}
+
+
+CTraceSpan::CTraceSpan(CTraceLog& trace, const std::string& strName, const std::string& strCategory)
+  : m_trace(trace), m_strName(strName), m_strCategory(strCategory), m_iStart(0)
+{
+  if (m_trace.IsOpen())
+    m_iStart = m_trace.Now();
+}
+
+
+CTraceSpan::~CTraceSpan(void)
+{
+  if (m_trace.IsOpen())
+    m_trace.AddSpan(m_strName, m_strCategory, m_iStart, m_trace.Now(), m_vecArgs);
+}
+
+
+void CTraceSpan::AddArg(const std::string& strKey, const std::string& strValue)
+{
+  if (m_trace.IsOpen())
+    m_vecArgs.push_back(std::make_pair(strKey, strValue));
+}
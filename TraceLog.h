@@ -0,0 +1,63 @@
+#pragma once
+#ifndef TRACE_LOG_H
+#define TRACE_LOG_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+#include "Clock.h"
+
+// Writes Chrome/Perfetto trace-event JSON (load in chrome://tracing or ui.perfetto.dev)
+class CTraceLog
+{
+  public:
+    CTraceLog(void) {};   // Constructor (empty)
+    ~CTraceLog(void);     // Destructor (closes the trace)
+
+    bool Open(const std::string& strFile);
+    void Close(void);
+    bool IsOpen(void) const { return m_fStream.is_open(); };
+    void SetClock(CClock* pClock);            // Use a (virtual) engine clock instead of the steady clock
+
+    uint64_t Now(void) const;                 // Microseconds since Open()
+    void AddSpan(const std::string& strName, const std::string& strCategory, const uint64_t iStart, const uint64_t iEnd,
+                 const std::vector<std::pair<std::string, std::string> >& vecArgs);
+    // Span that may overlap others on the same thread, shown on its own track per id
+    void AddAsyncSpan(const std::string& strName, const std::string& strCategory, const uint64_t iId, const uint64_t iStart, const uint64_t iEnd,
+                      const std::vector<std::pair<std::string, std::string> >& vecArgs);
+
+  private:
+    void WriteEvent(const std::string& strName, const std::string& strCategory, const char* szPhase, const uint64_t iTime,
+                    const std::string& strExtra, const std::vector<std::pair<std::string, std::string> >& vecArgs);
+
+    std::ofstream m_fStream;
+    std::mutex m_mutex;
+    std::chrono::steady_clock::time_point m_start;
+    CClock* m_pClock = NULL;
+    uint64_t m_iClockStart = 0;
+    bool m_bFirstEvent = true;
+};
+
+
+// Scoped span: records the time between construction and destruction (no-op if the trace isn't open)
+class CTraceSpan
+{
+  public:
+    CTraceSpan(CTraceLog& trace, const std::string& strName, const std::string& strCategory);
+    ~CTraceSpan(void);
+
+    void AddArg(const std::string& strKey, const std::string& strValue);
+
+  private:
+    CTraceLog& m_trace;
+    std::string m_strName;
+    std::string m_strCategory;
+    uint64_t m_iStart;
+    std::vector<std::pair<std::string, std::string> > m_vecArgs;
+};
+
+#endif // TRACE_LOG_H
@@ -0,0 +1,30 @@
+#include "Win32Backend.h"
+
+#include <windows.h>
+#include <winnetwk.h>
+
+NetResult CWin32Backend::AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags)
+{
+  NETRESOURCE nr;       // NETResource structure
+  // Assign values to the NETRESOURCE structure
+  nr.dwType = RESOURCETYPE_ANY;
+  nr.lpLocalName = (LPSTR) strLocal.c_str();    // LPSTR = *char
+  nr.lpRemoteName = (LPSTR) strRemote.c_str();  // LPSTR = *char
+  nr.lpProvider = NULL;
+
+  DWORD dwFlags = 0;
+  if (iFlags & NET_CONNECT_UPDATE_PROFILE)
+    dwFlags |= CONNECT_UPDATE_PROFILE;
+  if (iFlags & NET_CONNECT_INTERACTIVE)
+    dwFlags |= CONNECT_INTERACTIVE;
+  if (iFlags & NET_CONNECT_PROMPT)
+    dwFlags |= CONNECT_PROMPT;
+
+  return WNetAddConnection2(&nr, NULL, NULL, dwFlags);
+}
+
+
+NetResult CWin32Backend::CancelConnection(const std::string& strLocal)
+{
+  return WNetCancelConnection2(strLocal.c_str(), 0, TRUE);
+}
@@ -0,0 +1,15 @@
+#pragma once
+#ifndef WIN32_BACKEND_H
+#define WIN32_BACKEND_H
+
+#include "NetBackend.h"
+
+// The real thing: WNetAddConnection2/WNetCancelConnection2
+class CWin32Backend : public CNetBackend
+{
+  public:
+    NetResult AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags);
+    NetResult CancelConnection(const std::string& strLocal);
+};
+
+#endif // WIN32_BACKEND_H
@@ -8,18 +8,22 @@
 
   Target compiler : GCC/G++ or Visual Studio 2022
   C++ standard    : C++11
-  Dependencies    : CmdArguments.h StringUtils.h
+  Dependencies    : CmdArguments.h StringUtils.h Clock.h CircuitBreaker.h TraceLog.h NetBackend.h Win32Backend.h HostLimiter.h HealthCache.h Resolver.h Metrics.h ErrorTable.h
   Initial date    : December 10, 2002
   Last modified   : August 26, 2024
 */
 
 #include "WinMount.h"
 #include "CmdArguments.h"
-#include "stringutils.h"
+#include "StringUtils.h"
+#include "Win32Backend.h"
 
 #include <winnetwk.h>
 
 #include <iostream> // For std::cerr/cout
+#include <algorithm> // For std::find_if/std::sort
+#include <thread>
+#include <random>
 #include <conio.h>  // For _kbhit & _getch()
 
 #pragma comment(lib, "mpr.lib")
@@ -30,18 +34,55 @@
 // Delay in ms between retries
 #define RETRY_DELAY 3000
 
+// Time in ms a failed name resolution is cached
+#define RESOLVE_NEGATIVE_TTL 10000
+
 const char *VERSION = "1.50c";
 
 
 void ShowHelp()
 {
-  std::cerr << "Usage: winmount.exe [options] [mount_file]" << std::endl << std::endl;
-  std::cerr << "[mount_file]        : Path to the mount configuration file (default = \\mount.ini)" << std::endl;
+  std::cerr << "Usage: winmount.exe [options] [mount_file|directory ...]" << std::endl << std::endl;
+  std::cerr << "[mount_file]        : Path to a mount configuration file (default = \\mount.ini)" << std::endl;
+  std::cerr << "[directory]         : Use all mount files (*.ini) in the directory, in name order" << std::endl;
+  std::cerr << "                      Files given first (and earlier in name order) take precedence: a drive letter keeps" << std::endl;
+  std::cerr << "                      its first entry, later entries mapping it to another share are skipped with a warning" << std::endl;
   std::cerr << "-h|--help           : This screen" << std::endl;
   std::cerr << "-i|--interactive    : Force interactive mode" << std::endl;
   std::cerr << "-p|--persist        : Remember connections (persist)" << std::endl;
   std::cerr << "-u|--unmount        : Unmount (existing) drives before mount" << std::endl;
   std::cerr << "-r|--retry          : Retry until all connections are successfully mounted (if not specified, retry 10 times)" << std::endl;
+  std::cerr << "--stream                : Start connecting while the mount file is still being read" << std::endl;
+  std::cerr << "--on-parse-error=<p>    : abort (default) or continue (skip invalid mount file lines)" << std::endl;
+  std::cerr << "--error-class=<c>=<cl>  : Treat result code <c> as class <cl>: success, transient, host-down (transient, the host is" << std::endl;
+  std::cerr << "                          unavailable), permanent, credentials or cancel" << std::endl;
+  std::cerr << "                          (comma separated list, eg. --error-class=67=transient,5=permanent)" << std::endl;
+  std::cerr << "--breaker-threshold=<n> : Suspend a host after n consecutive failures (default = 3, 0 = disabled)" << std::endl;
+  std::cerr << "--breaker-cooldown=<s>  : Seconds before a suspended host is probed again (default = 10)" << std::endl;
+  std::cerr << "--max-connects=<n>      : Max. number of connect attempts in flight (default = 4)" << std::endl;
+  std::cerr << "--host-connects=<n>     : Max. number of connect attempts in flight per server (default = 2)" << std::endl;
+  std::cerr << "--host-rate=<n>         : Max. number of new connect attempts per second per server (default = 0 = unlimited)" << std::endl;
+  std::cerr << "--health-cache[=<name>]  : Share host health with other WinMount instances on this machine" << std::endl;
+  std::cerr << "                          (creating it machine wide requires SeCreateGlobalPrivilege, eg. a service or administrator," << std::endl;
+  std::cerr << "                          otherwise it's only shared with instances in the same logon session)" << std::endl;
+  std::cerr << "--start-jitter=<ms>     : Random delay before mapping starts (default = 1000 with --health-cache, else 0)" << std::endl;
+  std::cerr << "--resolve-ttl=<s>        : Resolve all server names concurrently up front and cache them <s> seconds (default = 300, 0 = disabled)" << std::endl;
+  std::cerr << "--resolver-file=<file>  : Simulate name resolution from <file> with \"<server> <ok|fail> [latency ms]\" lines" << std::endl;
+  std::cerr << "--metrics-file=<file>   : Write Prometheus metrics to <file> periodically and when done" << std::endl;
+  std::cerr << "--metrics-interval=<s>  : Seconds between metrics file updates (default = 10)" << std::endl;
+  std::cerr << "--metrics-port=<n>      : Serve Prometheus metrics over HTTP on localhost port <n>" << std::endl;
+  std::cerr << "--trace=<file>          : Write a Chrome/Perfetto trace-event timeline of the run to <file>" << std::endl;
+  std::cerr << "--record=<file>         : Record every connection call and name resolution, its result and latency to <file>" << std::endl;
+  std::cerr << "--replay=<file>         : Replay a recorded run against a simulated backend (no network access)" << std::endl;
+  std::cerr << "--virtual-clock         : Run a replay in simulated time: delays, timeouts and latencies take no real time" << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Mount file lines are \"<drive>: \\\\server\\share [| attributes]\", optional per-share attributes:" << std::endl;
+  std::cerr << "  retries=<n>|forever  : Number of attempts for this share" << std::endl;
+  std::cerr << "  delay=<s>            : Seconds between attempts" << std::endl;
+  std::cerr << "  timeout=<s>          : Give up on this share <s> seconds after its first attempt" << std::endl;
+  std::cerr << "  persist              : Remember this connection" << std::endl;
+  std::cerr << "  interactive=<mode>   : never, fallback (default) or always" << std::endl;
+  std::cerr << "  priority=<n>         : Shares with a higher priority are connected first (default = 0)" << std::endl;
 }
 
 
@@ -82,37 +123,40 @@ static void ArgumentBadOption(const std::string& strArgument)
 
 std::string ShowError(const int error_code)
 {
-  std::string strError;
+  return CErrorTable::Describe((DWORD) error_code);
+}
+
+
+// Extract the (lowercase) server name from \\server\share
+static std::string HostFromRemote(const std::string& strRemote)
+{
+  const size_t iEnd = strRemote.find('\\', 2);
+  if (iEnd == std::string::npos)
+    return StringUtils::ToLower(strRemote.substr(2));
+
+  return StringUtils::ToLower(strRemote.substr(2, iEnd - 2));
+}
 
-  // Info from http://msdn.microsoft.com/en-us/library/ms681381.aspx
 
-  switch (error_code)
+// Get the integer value of an option, showing an error if it's missing or below iMin
+static bool GetIntOption(CCmdArguments& arguments, const std::string& strArgument, int& iValue, const int iMin = 0)
+{
+  std::string strValue;
+  int32_t iOption;
+  if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
   {
-    case ERROR_SUCCESS                        : strError = "OK"; break;
-    case ERROR_PATH_NOT_FOUND                 : strError = "Path not found (3)"; break;
-    case ERROR_ACCESS_DENIED                  : strError = "Access denied (5)"; break;
-    case ERROR_UNEXP_NET_ERR                  : strError = "Unexpected network error (59)"; break;
-    case ERROR_NETNAME_DELETED                : strError = "The specified network name is no longer available (64)"; break;
-    case ERROR_NETWORK_ACCESS_DENIED          : strError = "Network access is denied (65)"; break;
-    case ERROR_BAD_DEV_TYPE                   : strError = "Incorrect network resource (66)"; break;
-    case ERROR_BAD_NET_NAME                   : strError = "Bad network name (67)"; break;
-    case ERROR_ALREADY_ASSIGNED               : strError = "Drive already assigned (85)"; break;
-    case ERROR_INVALID_PASSWORD               : strError = "The specified network password is not correct (86)"; break;
-    case ERROR_BUSY                           : strError = "The requested resource is busy (170)"; break;
-    case ERROR_DEVICE_ALREADY_REMEMBERED      : strError = "Local device already in use (1202)"; break;
-    case ERROR_NO_NET_OR_BAD_PATH             : strError = "Network path not found or not available (1203)"; break;
-    case ERROR_SESSION_CREDENTIAL_CONFLICT    : strError = "Credential conflict (1219)"; break;
-    case ERROR_NO_NETWORK                     : strError = "The network is not present or not started (1222)"; break;
-    case ERROR_CANCELLED                      : strError = "User cancelled (1223)"; break;
-    case ERROR_NETWORK_UNREACHABLE            : strError = "Network unreachable (1231)"; break;
-    case ERROR_PORT_UNREACHABLE               : strError = "Destination port unreachable (1234)"; break;
-    case ERROR_LOGON_FAILURE                  : strError = "Bad user name or password (1326)"; break;
-    case ERROR_CANT_ACCESS_DOMAIN_INFO        : strError = "Cannot access domain info (1351)"; break;
-    case ERROR_NOT_CONNECTED                  : strError = "Network connection does not exist (2250)"; break;
-    default                                   : strError = "Unknown error (" + std::to_string(error_code) + ")";
+    ArgumentValueEmpty(strArgument);
+    return false;
   }
 
-  return strError;
+  if (!StringUtils::StringToInt32(strValue, iOption) || iOption < iMin)
+  {
+    ArgumentInvalidValueForOption(strArgument);
+    return false;
+  }
+
+  iValue = iOption;
+  return true;
 }
 
 
@@ -120,6 +164,12 @@ std::string ShowError(const int error_code)
 bool CWinMount::ProcessCommandLine(const std::vector<std::string>& vecArgs)
 {
  CCmdArguments arguments(vecArgs);
+  std::string strRecordFile, strReplayFile;
+  bool bVirtualClock = false;
+
+  // Defaults for shares without attributes in the mount file
+  m_defaultPolicy.iRetries = RETRY_COUNT;
+  m_defaultPolicy.dwDelay = RETRY_DELAY;
 
   while (arguments.ProcessArgument())
   {
@@ -146,7 +196,7 @@ bool CWinMount::ProcessCommandLine(const std::vector<std::string>& vecArgs)
           ArgumentNoValueForOption(strArgument);
           return false;
         }
-        m_dwConnectFlags |= CONNECT_UPDATE_PROFILE;
+        m_defaultPolicy.bPersist = true;
       }
       else if (arguments.TestOption("interactive", "i"))
       {
@@ -155,7 +205,7 @@ bool CWinMount::ProcessCommandLine(const std::vector<std::string>& vecArgs)
           ArgumentNoValueForOption(strArgument);
           return false;
         }
-        m_dwConnectFlags |= CONNECT_INTERACTIVE;
+        m_defaultPolicy.interactive = INTERACTIVE_ALWAYS;
       }
       else if (arguments.TestOption("unmount", "u"))
       {
@@ -173,7 +223,173 @@ bool CWinMount::ProcessCommandLine(const std::vector<std::string>& vecArgs)
           ArgumentNoValueForOption(strArgument);
           return false;
         }
-        m_bRetryForever = true;
+        m_defaultPolicy.iRetries = 0;
+      }
+      else if (arguments.TestOption("breaker-threshold"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iBreakerThreshold))
+          return false;
+      }
+      else if (arguments.TestOption("breaker-cooldown"))
+      {
+        int32_t iValue;
+        if (!GetIntOption(arguments, strArgument, iValue))
+          return false;
+        m_iBreakerCoolDown = (uint64_t) iValue * 1000;
+      }
+      else if (arguments.TestOption("max-connects"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iMaxConnects, 1))
+          return false;
+      }
+      else if (arguments.TestOption("host-connects"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iHostConnects, 1))
+          return false;
+      }
+      else if (arguments.TestOption("host-rate"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iHostRate))
+          return false;
+      }
+      else if (arguments.TestOption("health-cache"))
+      {
+        std::string strName = "WinMountHostHealth";
+        if (arguments.OptionHasValue())
+          arguments.GetOptionValue(strName);
+
+        if (!m_healthCache.Open(strName))
+          std::cerr << "WARNING: Unable to open the shared host-health cache \"" << strName << "\"" << std::endl;
+        else if (m_healthCache.IsLocal())
+          std::cerr << "WARNING: Not allowed to create the machine wide host-health cache \"" << strName << "\", only sharing it within this session" << std::endl;
+      }
+      else if (arguments.TestOption("start-jitter"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iStartJitter))
+          return false;
+      }
+      else if (arguments.TestOption("resolve-ttl"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iResolveTtl))
+          return false;
+      }
+      else if (arguments.TestOption("resolver-file"))
+      {
+        std::string strValue;
+        if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
+        {
+          ArgumentValueEmpty(strArgument);
+          return false;
+        }
+        m_strResolverFile = StringUtils::Trim(strValue, "\"\'");
+      }
+      else if (arguments.TestOption("metrics-file"))
+      {
+        std::string strValue;
+        if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
+        {
+          ArgumentValueEmpty(strArgument);
+          return false;
+        }
+        m_strMetricsFile = StringUtils::Trim(strValue, "\"\'");
+        m_metrics.Enable();
+      }
+      else if (arguments.TestOption("metrics-interval"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iMetricsInterval, 1))
+          return false;
+      }
+      else if (arguments.TestOption("metrics-port"))
+      {
+        if (!GetIntOption(arguments, strArgument, m_iMetricsPort, 1))
+          return false;
+        m_metrics.Enable();
+      }
+      else if (arguments.TestOption("trace"))
+      {
+        std::string strValue;
+        if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
+        {
+          ArgumentValueEmpty(strArgument);
+          return false;
+        }
+        if (!m_trace.Open(StringUtils::Trim(strValue, "\"\'")))
+        {
+          std::cerr << "ERROR: Unable to create trace file \"" << strValue << "\"" << std::endl;
+          return false;
+        }
+      }
+      else if (arguments.TestOption("record") || arguments.TestOption("replay"))
+      {
+        std::string strValue;
+        if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
+        {
+          ArgumentValueEmpty(strArgument);
+          return false;
+        }
+        if (strRecordFile.size() || strReplayFile.size())
+        {
+          // Only one of --record/--replay
+          ArgumentSyntaxError(strArgument);
+          return false;
+        }
+
+        if (arguments.TestOption("record"))
+          strRecordFile = StringUtils::Trim(strValue, "\"\'");
+        else
+          strReplayFile = StringUtils::Trim(strValue, "\"\'");
+      }
+      else if (arguments.TestOption("virtual-clock"))
+      {
+        if (arguments.OptionHasValue())
+        {
+          ArgumentNoValueForOption(strArgument);
+          return false;
+        }
+        bVirtualClock = true;
+      }
+      else if (arguments.TestOption("error-class"))
+      {
+        std::string strValue;
+        if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
+        {
+          ArgumentValueEmpty(strArgument);
+          return false;
+        }
+
+        if (!m_errorTable.ParseOverrides(strValue))
+        {
+          ArgumentInvalidValueForOption(strArgument);
+          return false;
+        }
+      }
+      else if (arguments.TestOption("stream"))
+      {
+        if (arguments.OptionHasValue())
+        {
+          ArgumentNoValueForOption(strArgument);
+          return false;
+        }
+        m_bStream = true;
+      }
+      else if (arguments.TestOption("on-parse-error"))
+      {
+        std::string strValue;
+        if (!arguments.OptionHasValue() || !arguments.GetOptionValue(strValue))
+        {
+          ArgumentValueEmpty(strArgument);
+          return false;
+        }
+
+        if (StringUtils::EqualsNoCase(strValue, "continue"))
+          m_bSkipInvalid = true;
+        else if (StringUtils::EqualsNoCase(strValue, "abort"))
+          m_bSkipInvalid = false;
+        else
+        {
+          ArgumentInvalidValueForOption(strArgument);
+          return false;
+        }
       }
       else
       {
@@ -182,49 +398,293 @@ bool CWinMount::ProcessCommandLine(const std::vector<std::string>& vecArgs)
         return false;
       }
     }
-    else if (!m_strIniFile.size())
+    else
     {
-      m_strIniFile = StringUtils::Trim(strArgument, "\"\'");
+      m_vecIniFiles.push_back(StringUtils::Trim(strArgument, "\"\'"));
     }
-    else
+  }
+
+  // Simulated time only makes sense against a simulated backend, and the health cache is shared in real time
+  const bool bSimulated = (m_pBackend != NULL);  // Backend supplied by the caller
+  if (m_pClock && m_pClock->IsVirtual())
+    bVirtualClock = true;
+
+  if (bVirtualClock && ((!strReplayFile.size() && !bSimulated) || m_healthCache.IsOpen()))
+  {
+    std::cerr << "ERROR: --virtual-clock requires --replay and can't be used with --health-cache" << std::endl;
+    return false;
+  }
+
+  if (!m_pClock && bVirtualClock)
+    m_pClock.reset(new CVirtualClock);
+  else if (!m_pClock)
+    m_pClock.reset(new CSystemClock);
+
+  if (m_pClock->IsVirtual())
+    m_trace.SetClock(m_pClock.get());
+
+  CRecordingBackend* pRecorder = NULL;
+  CReplayBackend* pReplay = NULL;
+  if (bSimulated)
+  {
+    m_bReplay = true;
+  }
+  else if (strRecordFile.size())
+  {
+    pRecorder = new CRecordingBackend(new CWin32Backend);
+    m_pBackend.reset(pRecorder);
+    if (!pRecorder->Open(strRecordFile))
+    {
+      std::cerr << "ERROR: Unable to create record file \"" << strRecordFile << "\"" << std::endl;
+      return false;
+    }
+  }
+  else if (strReplayFile.size())
+  {
+    pReplay = new CReplayBackend(*m_pClock);
+    m_pBackend.reset(pReplay);
+    if (!pReplay->Open(strReplayFile))
+    {
+      std::cerr << "ERROR: Unable to read record file \"" << strReplayFile << "\"" << std::endl;
+      return false;
+    }
+    m_bReplay = true;
+  }
+  else
+  {
+    m_pBackend.reset(new CWin32Backend);
+  }
+
+  m_limiter.SetLimits(m_iMaxConnects, m_iHostConnects, m_iHostRate);
+
+  // Name resolution: simulated, as recorded when replaying (no network access) or the system resolver
+  // (recorded along with the calls when recording). A simulated backend has no recorded resolutions
+  if (m_strResolverFile.size())
+  {
+    CStaticResolver* pResolver = new CStaticResolver(*m_pClock);
+    m_nameCache.SetResolver(pResolver, *m_pClock, (uint64_t) m_iResolveTtl * 1000, RESOLVE_NEGATIVE_TTL);
+    if (!pResolver->Open(m_strResolverFile))
     {
-      ArgumentSyntaxError(strArgument);
+      std::cerr << "ERROR: Unable to read resolver file \"" << m_strResolverFile << "\"" << std::endl;
       return false;
     }
   }
+  else if (m_iResolveTtl > 0 && pReplay)
+  {
+    m_nameCache.SetResolver(new CReplayResolver(*pReplay), *m_pClock, (uint64_t) m_iResolveTtl * 1000, RESOLVE_NEGATIVE_TTL);
+  }
+  else if (m_iResolveTtl > 0 && !bSimulated)
+  {
+    CResolver* pResolver = new CSystemResolver;
+    if (pRecorder)
+      pResolver = new CRecordingResolver(pResolver, *pRecorder);
+    m_nameCache.SetResolver(pResolver, *m_pClock, (uint64_t) m_iResolveTtl * 1000, RESOLVE_NEGATIVE_TTL);
+  }
+
+  if (m_iMetricsPort && !m_metrics.StartServer(m_iMetricsPort))
+    std::cerr << "WARNING: Unable to serve metrics on localhost port " << m_iMetricsPort << std::endl;
+
+  // Avoid instances that start at the same moment (logon storm) from hitting the servers in lockstep
+  if (m_iStartJitter < 0)
+    m_iStartJitter = m_healthCache.IsOpen() ? 1000 : 0;
 
   // Success:
   return true;
 }
 
 
+// Split the "key=value" (or "persist") attributes following the '|' separator off strRemote into policy.
+// Everything before the separator is the remote name, so share names can contain spaces, '=' or "persist"
+bool CWinMount::ParsePolicy(std::string& strRemote, CSharePolicy& policy) const
+{
+  policy = m_defaultPolicy;
+
+  std::string strAttributes;
+  const size_t iSeparator = strRemote.find('|');
+  if (iSeparator != std::string::npos)
+  {
+    strAttributes = strRemote.substr(iSeparator + 1);
+    strRemote = strRemote.substr(0, iSeparator);
+  }
+  strRemote = StringUtils::Trim(strRemote);
+
+  for (const std::string& strAttribute : StringUtils::Tokenize(strAttributes, " \t"))
+  {
+    std::string strKey, strValue;
+    int32_t iValue = 0;
+
+    if (StringUtils::EqualsNoCase(strAttribute, "persist"))
+    {
+      policy.bPersist = true;
+    }
+    else if (!StringUtils::Split(strAttribute, "=", strKey, strValue))
+    {
+      return false; // Not an attribute
+    }
+    else if (StringUtils::EqualsNoCase(strKey, "retries"))
+    {
+      if (StringUtils::EqualsNoCase(strValue, "forever"))
+        policy.iRetries = 0;
+      else if (StringUtils::StringToInt32(strValue, iValue) && iValue > 0)
+        policy.iRetries = iValue;
+      else
+        return false;
+    }
+    else if (StringUtils::EqualsNoCase(strKey, "delay") || StringUtils::EqualsNoCase(strKey, "timeout"))
+    {
+      if (!StringUtils::StringToInt32(strValue, iValue) || iValue < 0)
+        return false;
+
+      if (StringUtils::EqualsNoCase(strKey, "delay"))
+        policy.dwDelay = (DWORD) iValue * 1000;
+      else
+        policy.dwTimeout = (DWORD) iValue * 1000;
+    }
+    else if (StringUtils::EqualsNoCase(strKey, "interactive"))
+    {
+      if (StringUtils::EqualsNoCase(strValue, "never"))
+        policy.interactive = INTERACTIVE_NEVER;
+      else if (StringUtils::EqualsNoCase(strValue, "fallback"))
+        policy.interactive = INTERACTIVE_FALLBACK;
+      else if (StringUtils::EqualsNoCase(strValue, "always"))
+        policy.interactive = INTERACTIVE_ALWAYS;
+      else
+        return false;
+    }
+    else if (StringUtils::EqualsNoCase(strKey, "priority"))
+    {
+      if (!StringUtils::StringToInt32(strValue, iValue))
+        return false;
+
+      policy.iPriority = iValue;
+    }
+    else
+    {
+      return false; // Unknown attribute
+    }
+  }
+
+  return true;
+}
+
+
 bool CWinMount::ProcessIniFile()
 {
   // If not configuration file is specified, fallback to \mount.ini
-  if (!m_strIniFile.size())
-    m_strIniFile = "\\mount.ini";
+  if (m_vecIniFiles.empty())
+    m_vecIniFiles.push_back("\\mount.ini");
 
-  m_fStream.open(m_strIniFile, std::ios::in);
-  if (!m_fStream.is_open())
+  // Directories are expanded to the mount files (*.ini) in them, in name order
+  std::vector<std::string> vecFiles;
+  for (auto& strPath : m_vecIniFiles)
   {
-    const std::string strMsg = "WinMount: An error occurred opening the configuration file " + m_strIniFile + ". Program aborted";
-    MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
-    return false;
+    const DWORD dwAttributes = GetFileAttributes(strPath.c_str());
+    if (dwAttributes == INVALID_FILE_ATTRIBUTES || !(dwAttributes & FILE_ATTRIBUTE_DIRECTORY))
+    {
+      vecFiles.push_back(strPath);
+      continue;
+    }
+
+    // Keep the separator style of the path ('/' works on Windows too)
+    const bool bSlash = (strPath.find('\\') == std::string::npos && strPath.find('/') != std::string::npos);
+    const std::string strDir = StringUtils::TrimRight(strPath, "\\/") + (bSlash ? "/" : "\\");
+    std::vector<std::string> vecDirFiles;
+    WIN32_FIND_DATA findData;
+    HANDLE hFind = FindFirstFile((strDir + "*.ini").c_str(), &findData);
+    if (hFind != INVALID_HANDLE_VALUE)
+    {
+      do
+      {
+        if (!(findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+          vecDirFiles.push_back(strDir + findData.cFileName);
+      } while (FindNextFile(hFind, &findData));
+
+      FindClose(hFind);
+    }
+
+    if (vecDirFiles.empty())
+      Print("WARNING: No mount files (*.ini) found in " + strPath);
+
+    std::sort(vecDirFiles.begin(), vecDirFiles.end(),
+              [](const std::string& a, const std::string& b) { return StringUtils::ToLower(a) < StringUtils::ToLower(b); });
+    vecFiles.insert(vecFiles.end(), vecDirFiles.begin(), vecDirFiles.end());
+  }
+  m_vecIniFiles = vecFiles;
+
+  // Open them all up front, so a missing file is reported before anything is mapped
+  for (auto& strFile : m_vecIniFiles)
+  {
+    CTraceSpan span(m_trace, "load config", "config");
+    span.AddArg("file", strFile);
+
+    m_deqStreams.emplace_back();
+    m_deqStreams.back().open(strFile, std::ios::in);
+    if (!m_deqStreams.back().is_open())
+    {
+      const std::string strMsg = "WinMount: An error occurred opening the configuration file " + strFile + ". Program aborted";
+      ErrorBox(strMsg);
+      return false;
+    }
   }
 
+  // When streaming, MapDrives() parses the files while it connects (virtual time has a single thread though)
+  if (m_bStream && !m_pClock->IsVirtual())
+    return true;
+
+  return ParseIniFiles();
+}
+
+
+// Merge all mount files into a single set of shares. The first entry for a drive letter wins (in the same
+// file, as a single file always did, or in an earlier file): identical entries are dropped, conflicting
+// ones are skipped with a warning
+bool CWinMount::ParseIniFiles(void)
+{
+  CTraceSpan span(m_trace, "parse", "config");
+
+  for (size_t iFile = 0; iFile < m_vecIniFiles.size(); iFile++)
+  {
+    if (!ParseIniFile(m_vecIniFiles[iFile], m_deqStreams[iFile]))
+      return false;
+  }
+
+  span.AddArg("files", std::to_string(m_vecIniFiles.size()));
+  span.AddArg("shares", std::to_string(m_mapDrives.size()));
+
+  return true;
+}
+
+
+// Report an invalid line in a mount file. Returns true if it should be skipped, false to abort
+bool CWinMount::InvalidLine(const std::string& strFile, const int iLine, const std::string& strProblem)
+{
+  if (m_bSkipInvalid)
+  {
+    Print("WARNING: Line " + std::to_string(iLine) + " in config-file " + strFile + " " + strProblem + ", skipped");
+    return true;
+  }
+
+  const std::string strMsg = "WinMount: Line " + std::to_string(iLine) + " in config-file " + strFile + " " + strProblem + ". Program aborted";
+  ErrorBox(strMsg);
+  return false;
+}
+
+
+bool CWinMount::ParseIniFile(const std::string& strFile, std::ifstream& fStream)
+{
   int iLineCount = 0;
-  while (!m_fStream.eof())
+  while (!fStream.eof())
   {
     iLineCount++;
 
     // Read line from mount.ini into strLine
     std::string strLine;
-    std::getline(m_fStream, strLine);
+    std::getline(fStream, strLine);
 
-    if (m_fStream.bad())
+    if (fStream.bad())
     {
-      const std::string strMsg = "WinMount: An error occurred reading config-file " + m_strIniFile + " at line " + std::to_string(iLineCount) + ". Program aborted";
-      MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
+      const std::string strMsg = "WinMount: An error occurred reading config-file " + strFile + " at line " + std::to_string(iLineCount) + ". Program aborted";
+      ErrorBox(strMsg);
       return false;
     }
 
@@ -232,15 +692,34 @@ bool CWinMount::ProcessIniFile()
     if (strLine.size() && strLine[0] != ';' && strLine.size())
     {
       std::string strLocal, strRemote;
-      if (!StringUtils::Split(strLine, " ", strLocal, strRemote) || strLocal.size() != 2 || strLocal[1] != ':' || strRemote.size() < 3 || strRemote.substr(0,2) != "\\\\" || strRemote.size() > MAX_PATH)
+      CSharePolicy policy;
+      if (!StringUtils::Split(strLine, " ", strLocal, strRemote) || !ParsePolicy(strRemote, policy) || strLocal.size() != 2 || strLocal[1] != ':' || strRemote.size() < 3 || strRemote.substr(0,2) != "\\\\" || strRemote.size() > MAX_PATH)
       {
-        const std::string strMsg = "WinMount: Line " + std::to_string(iLineCount) + " in config-file " + m_strIniFile + " is invalid. Program aborted";
-        MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
+        if (InvalidLine(strFile, iLineCount, "is invalid"))
+          continue;
+
         return false;
       }
 
-      CNetShare netShare(strLocal,strRemote);
-      m_vecNetShares.push_back(netShare);
+      // Drive letter mapped before?
+      const std::string strDrive = StringUtils::ToUpper(strLocal);
+      std::map<std::string, CDriveSource>::const_iterator it = m_mapDrives.find(strDrive);
+      if (it != m_mapDrives.end())
+      {
+        // The first entry wins, identical ones are dropped silently
+        if (!StringUtils::EqualsNoCase(it->second.strRemote, strRemote))
+          Print("WARNING: Line " + std::to_string(iLineCount) + " in config-file " + strFile + " maps " + strLocal + " which is already mapped to " + it->second.strRemote + " by " + it->second.strFile + ", skipped");
+
+        continue;
+      }
+
+      CDriveSource source;
+      source.strRemote = strRemote;
+      source.strFile = strFile;
+      m_mapDrives[strDrive] = source;
+
+      if (!AddShare(CNetShare(strLocal, strRemote, HostFromRemote(strRemote), policy)))
+        return false; // Cancelled
     }
   }
 
@@ -248,10 +727,34 @@ bool CWinMount::ProcessIniFile()
 }
 
 
+// Add a share to the mapping engine (possibly while it's running). Returns false if mapping was cancelled
+bool CWinMount::AddShare(const CNetShare& netShare)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if (m_bCancelled)
+    return false;
+
+  m_deqNetShares.push_back(netShare);
+
+  // Connect shares with a higher priority first (keeping file order otherwise)
+  const int iPriority = netShare.GetPolicy().iPriority;
+  std::vector<size_t>::iterator it = std::find_if(m_vecOrder.begin(), m_vecOrder.end(),
+                                                  [this, iPriority](size_t iShare) { return m_deqNetShares[iShare].GetPolicy().iPriority < iPriority; });
+  m_vecOrder.insert(it, m_deqNetShares.size() - 1);
+
+  if (m_bParsing)
+    StartResolve(netShare.GetHostName());
+
+  m_cvDone.notify_all();
+
+  return true;
+}
+
+
 bool CWinMount::AllDrivesMapped() const
 {
   bool bMappedAll = true;
-  for (auto& netShare : m_vecNetShares)
+  for (auto& netShare : m_deqNetShares)
   {
     if (!netShare.IsMapped())
       bMappedAll = false;
@@ -261,141 +764,673 @@ bool CWinMount::AllDrivesMapped() const
 }
 
 
+CCircuitBreaker& CWinMount::GetBreaker(const std::string& strHost)
+{
+  std::map<std::string, CCircuitBreaker>::iterator it = m_mapBreakers.find(strHost);
+  if (it == m_mapBreakers.end())
+    it = m_mapBreakers.insert(std::make_pair(strHost, CCircuitBreaker(m_iBreakerThreshold, m_iBreakerCoolDown))).first;
+
+  return it->second;
+}
+
+
+// Feed the result of a connect attempt to the breaker of its host (and other instances)
+void CWinMount::RecordResult(CNetShare& netShare, const DWORD result)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  CCircuitBreaker& breaker = GetBreaker(netShare.GetHostName());
+  netShare.SetLastResult(result);
+
+  // Only an answer from the server (success, or eg. a logon failure or a missing share) means the host is up.
+  // Transient results and cancelled dialogs say nothing about it
+  const EErrorClass errorClass = m_errorTable.Classify(result);
+  if (errorClass == ERROR_CLASS_HOST_DOWN)
+  {
+    const bool bWasOpen = (breaker.GetState() == CCircuitBreaker::STATE_OPEN);
+    breaker.RecordFailure(m_pClock->Now());
+    if (breaker.GetState() == CCircuitBreaker::STATE_OPEN)
+    {
+      if (!bWasOpen)
+        m_metrics.CountBreakerTrip();
+
+      Print("  Host " + netShare.GetHostName() + " is unavailable, suspending its shares for " + std::to_string(m_iBreakerCoolDown / 1000) + "s");
+
+      // Only publish hosts we consider down, not every single failure
+      m_healthCache.Publish(netShare.GetHostName(), false, GetTickCount64()); // Machine wide, not the engine clock
+    }
+  }
+  else if (errorClass == ERROR_CLASS_SUCCESS || errorClass == ERROR_CLASS_CREDENTIALS || errorClass == ERROR_CLASS_PERMANENT)
+  {
+    breaker.RecordSuccess();
+    m_healthCache.Publish(netShare.GetHostName(), true, GetTickCount64());
+  }
+}
+
+
+// Suspend a host another instance recently found to be unavailable, or probe a suspended host right
+// away when another instance reached it since. m_mutex must be held
+void CWinMount::CheckHealthCache(const std::string& strHost, CCircuitBreaker& breaker, const uint64_t iNow)
+{
+  bool bReachable;
+  uint64_t iUpdated;
+
+  if (!m_healthCache.Lookup(strHost, bReachable, iUpdated))
+    return;
+
+  // Only trust recent reports. An open breaker still probes the host after the cool-down,
+  // so a stale or bogus report costs at most one cool-down
+  if (iUpdated > iNow || iNow - iUpdated >= m_iBreakerCoolDown)
+    return;
+
+  if (!bReachable && breaker.GetState() == CCircuitBreaker::STATE_CLOSED)
+  {
+    breaker.ForceOpen(iUpdated);
+    if (breaker.GetState() == CCircuitBreaker::STATE_OPEN)
+      Print("  Host " + strHost + " was reported unavailable by another WinMount instance");
+  }
+  else if (bReachable && breaker.GetState() == CCircuitBreaker::STATE_OPEN && iUpdated > breaker.GetOpenedAt())
+  {
+    breaker.EndCoolDown();
+    Print("  Host " + strHost + " was reported available by another WinMount instance");
+  }
+}
+
+
+// Schedule the next attempt for a share after a failure (after its delay or at iRetryAt if given),
+// or give up when its retries or timeout are exhausted
+void CNetShare::ScheduleRetry(const uint64_t iNow, const uint64_t iRetryAt /* = 0 */)
+{
+  const uint64_t iNextAttempt = (iRetryAt ? iRetryAt : iNow + m_policy.dwDelay);
+  if ((m_policy.iRetries > 0 && m_iAttempts >= m_policy.iRetries) ||
+      (m_policy.dwTimeout > 0 && iNextAttempt - m_iFirstAttempt >= m_policy.dwTimeout))
+  {
+    m_bFailed = true;
+    return;
+  }
+
+  m_iNextAttempt = iNextAttempt;
+}
+
+
 bool CWinMount::MapDrives()
 {
-  for (int iRetryCount = 0; (m_bRetryForever || iRetryCount < RETRY_COUNT); iRetryCount++)
+  // Streaming: parse the mount file while connecting, each share is scheduled as soon as it's read
+  std::thread parser;
+  if (m_bStream && !m_pClock->IsVirtual())
   {
-    if (iRetryCount != 0)
+    m_bParsing = true;
+    parser = std::thread([this]
     {
-      Sleep(RETRY_DELAY);
+      const bool bParsed = ParseIniFiles();
+
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_bParsing = false;
+      if (!bParsed)
+        m_bCancelled = true; // Abort: no new attempts, wait for the ones in flight
+      m_cvDone.notify_all();
+    });
+  }
 
-//      std::cout << "Retry " << iRetryCount << ":" << std::endl;
+  // Resolve in the background, shares of a host are only attempted once it has been resolved
+  ResolveHosts();
+
+  if (m_iStartJitter > 0)
+  {
+    CTraceSpan span(m_trace, "start jitter", "wait");
+    std::mt19937 random((unsigned int) (GetCurrentProcessId() ^ m_pClock->Now()));
+    m_pClock->Sleep(random() % (m_iStartJitter + 1));
+  }
+
+  m_iRunStart = m_pClock->Now();
+  uint64_t iNextMetrics = m_iRunStart;
+
+  // Connect attempts run on a pool of worker threads, this thread only schedules them.
+  // In virtual time this thread runs them itself, one after the other
+  std::vector<std::thread> vecWorkers;
+  for (int i = 0; i < m_iMaxConnects && !m_pClock->IsVirtual(); i++)
+    vecWorkers.push_back(std::thread(&CWinMount::WorkerThread, this));
+
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    if (!m_bCancelled && _kbhit() && _getch() == 0x1B) // Abort on <ESC>
+    {
+      Print("User cancelled...");
+      m_bCancelled = true;
     }
 
-    for (auto& netShare : m_vecNetShares)
+    const uint64_t iNow = m_pClock->Now();
+    uint64_t iNextDue = UINT64_MAX;
+    bool bPending = false;
+    int iMapped = 0;
+
+    for (size_t iOrder = 0; iOrder < m_vecOrder.size(); iOrder++)
     {
-      if (!netShare.IsMapped())
+      const size_t iShare = m_vecOrder[iOrder];
+      CNetShare& netShare = m_deqNetShares[iShare];
+      if (netShare.IsMapped())
+        iMapped++;
+
+      if (netShare.IsDone())
+        continue;
+
+      if (netShare.IsInFlight())
       {
-        bool bTryInteractive = false;
-        const std::string& strLocal = netShare.GetLocalName();
-        const std::string& strRemote = netShare.GetRemoteName();
+        bPending = true; // Wait for it, even when cancelled
+        continue;
+      }
 
-        NETRESOURCE nr;       // NETResource structure
-        // Assign values to the NETRESOURCE structure
-        nr.dwType = RESOURCETYPE_ANY;
-        nr.lpLocalName = (LPSTR) strLocal.c_str();    // LPSTR = *char
-        nr.lpRemoteName = (LPSTR) strRemote.c_str();  // LPSTR = *char
-        nr.lpProvider = NULL;
+      if (m_bCancelled)
+        continue;
 
-        std::cout << "> Connecting " << strRemote << " to " << strLocal << "...";
-        if (m_bUnmount)
-        {
-          if (_kbhit() && _getch() == 0x1B) // Abort on <ESC>
-          {
-            std::cout << "User cancelled..." << std::endl;
-            return false;
-          }
-
-          // Terminate any existing mounts with this drive letter
-          const DWORD result = WNetCancelConnection2(nr.lpLocalName, 0, TRUE);
-          if (result != NO_ERROR && result != ERROR_NOT_CONNECTED)
-          {
-            std::cout << "Unable to unmount existing connection" << std::endl;
-
-            const std::string strMsg = ShowError(result) + "\nUnable to disconnect " + strLocal;
-            MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
-            
-            netShare.SetMapped(); // Flag as mapped, else we'll keep trying over and over again
-            continue;
-          }
-        }
+      bPending = true;
 
-        if ( !(m_dwConnectFlags & CONNECT_INTERACTIVE) )
+      // Wait for the credential dialog being shown, then try again right away (its session may be usable).
+      // The timeout of the share still applies
+      if (netShare.IsAwaitingPrompt())
+      {
+        if (netShare.IsExpired(iNow))
         {
-          if (_kbhit() && _getch() == 0x1B) // Abort on <ESC>
-          {
-            std::cout << "User cancelled..." << std::endl;
-            return false;
-          }
-
-          const DWORD result = WNetAddConnection2(&nr, NULL, NULL, m_dwConnectFlags);
-
-          if (result == ERROR_CANCELLED || result == NO_ERROR || result == ERROR_ALREADY_ASSIGNED)
-          {
-            std::cout << ShowError(result) << std::endl;
-
-            netShare.SetMapped();
-            continue;
-          }
-          else if (result == ERROR_DEVICE_ALREADY_REMEMBERED || result == ERROR_SESSION_CREDENTIAL_CONFLICT || result == ERROR_ALREADY_ASSIGNED)
-          {
-            // Unable to retry in interactive mode with errors above:
-            std::cout << "FATAL: " << ShowError(result) << std::endl;
-
-            const std::string strMsg = ShowError(result) + "\nUnable to connect " + strRemote + " to " + strLocal;
-            MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
-
-            netShare.SetMapped(); // Flag as mapped, else we'll keep trying over and over again
-            continue;
-          }
-
-          // NOTE: ERROR_BAD_DEV_TYPE(66) occurs when host is unavailable so don't enable interactive for that to allow retrying
-          if (result != ERROR_LOGON_FAILURE && result != ERROR_BAD_DEV_TYPE)
-          {
-            std::cout << "Non-fatal: " << ShowError(result) << "." << std::endl << "  Retry in interactive mode..." << std::endl;
-            bTryInteractive = true;
-          }
-          else
-          {
-            std::cout << ShowError(result) << std::endl;
-          }
+          GiveUp(netShare);
+          continue;
         }
 
-        // (Try) interactive mode?
-        if ((m_dwConnectFlags & CONNECT_INTERACTIVE) || bTryInteractive)
-        {
-          DWORD result = 0;
-          do
-          {
-            // (Retry) Call the WNetAddConnection2 function to assign a drive letter to the share (Prompt for username/pwd)
-            // Optionally add "| CONNECT_UPDATE_PROFILE"
-            result = WNetAddConnection2(&nr, NULL, NULL, CONNECT_INTERACTIVE | CONNECT_PROMPT | m_dwConnectFlags);
-            if (result == ERROR_NETWORK_UNREACHABLE || result == ERROR_NO_NET_OR_BAD_PATH)
-            {
-//              std::cout << show_error(result) << ".";
-              const std::string strMsg = ShowError(result) + "\nUnable to connect " + strRemote + " to " + strLocal;
-              MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
-            }
-          } while (result == ERROR_NETWORK_UNREACHABLE || result == ERROR_NO_NET_OR_BAD_PATH); // Only retry on network error
-
-          std::cout << ShowError(result) << std::endl;
-
-          if (result == ERROR_CANCELLED)
-          {
-            std::cout << std::endl;
-            //netShare.SetMapped(); // Flag as mapped, else we'll keep trying over and over again
-            return false;
-          }
-          else if (result != NO_ERROR)
-          {
-            const std::string strMsg = ShowError(result) + "\nUnable to connect " + strRemote + " to " + strLocal;
-            MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
-          }
-        }
+        if (m_strPromptHost.size())
+          continue;
+
+        netShare.SetAwaitingPrompt(false);
+      }
+
+      // Not due yet?
+      if (netShare.GetNextAttempt() > iNow)
+      {
+        iNextDue = std::min(iNextDue, netShare.GetNextAttempt());
+        continue;
+      }
+
+      // Wait for the (re-)resolution of the host in the background, which is never done holding a slot
+      const std::string strHost = netShare.GetHostName();
+      StartResolve(strHost);
+      if (m_setResolving.count(strHost))
+        continue;
+
+      // A failed resolution is only advisory: the name may be known to another network provider only. So make
+      // a single real attempt per failed resolution, then wait for it to expire. Waiting costs an attempt,
+      // so the retries of the share still apply
+      uint64_t iExpires = 0;
+      if (m_nameCache.Lookup(strHost, m_pClock->Now(), &iExpires) != CNameCache::STATE_FAILED)
+      {
+        iExpires = 0;
+      }
+      else if (netShare.GetUnresolvedAttempt() == iExpires)
+      {
+        TraceRetryWait(netShare, iShare);
+        netShare.StartAttempt(iNow);
+        RetryLater(netShare, iNextDue, "host can't be resolved", iExpires);
+        continue;
+      }
+
+      // Admission control: a slot must be free (we're woken when a job finishes) and a token available
+      if (!m_limiter.CanAcquire(strHost, iNow))
+      {
+        const uint64_t iNextToken = m_limiter.GetNextToken(strHost, iNow);
+        if (iNextToken > iNow)
+          iNextDue = std::min(iNextDue, iNextToken);
+        continue;
+      }
+
+      // Don't hammer a host that is down, only let a single probe through after the cool-down
+      CCircuitBreaker& breaker = GetBreaker(strHost);
+      CheckHealthCache(strHost, breaker, iNow);
+      if (!breaker.AllowAttempt(iNow))
+      {
+        // Count as a (failed) attempt so the retries/timeout of the share still apply
+        TraceRetryWait(netShare, iShare);
+        netShare.StartAttempt(iNow);
+        RetryLater(netShare, iNextDue, "host down (circuit breaker open)");
+        continue;
+      }
+
+      m_limiter.Acquire(strHost, iNow);
+      TraceRetryWait(netShare, iShare);
+      netShare.StartAttempt(iNow);
+      netShare.SetInFlight();
+      if (iExpires)
+        netShare.SetUnresolvedAttempt(iExpires);
+
+      CJob job;
+      job.iShare = iShare;
+      job.bProbe = breaker.IsProbing();
+      m_deqJobs.push_back(job);
+      m_cvJobs.notify_one();
+    }
+
+    // More shares may follow
+    if (m_bParsing && !m_bCancelled)
+      bPending = true;
+
+    m_metrics.SetDrives(iMapped, (int) m_deqNetShares.size() - iMapped);
+    if (m_strMetricsFile.size() && iNow >= iNextMetrics)
+    {
+      m_metrics.WriteFile(m_strMetricsFile);
+      iNextMetrics = iNow + (uint64_t) m_iMetricsInterval * 1000;
+    }
+
+    if (!bPending)
+      break; // Nothing left to do
+
+    if (!m_deqJobs.empty() && m_pClock->IsVirtual())
+    {
+      while (!m_deqJobs.empty())
+      {
+        const CJob job = m_deqJobs.front();
+        m_deqJobs.pop_front();
+        RunJob(job, lock);
       }
+      continue; // Time has moved on
     }
 
-    if (AllDrivesMapped())
-      return true; // We're done
+    if (m_strMetricsFile.size())
+      iNextDue = std::min(iNextDue, iNextMetrics);
+
+    // Wait for a job to finish or the first share that is due (but keep checking for <ESC>).
+    // Virtual time can jump straight to the share that is due
+    const uint64_t iWaitFrom = m_pClock->Now();
+    uint64_t iWait = (iNextDue > iWaitFrom ? iNextDue - iWaitFrom : 0);
+    if (!m_pClock->IsVirtual() || iNextDue == UINT64_MAX)
+      iWait = std::min((uint64_t) 250, iWait);
+
+    if (iWait > 0)
+      m_pClock->WaitFor(m_cvDone, lock, iWait);
   }
 
+  m_bStopWorkers = true;
+  m_cvJobs.notify_all();
+  lock.unlock();
+
+  for (auto& worker : vecWorkers)
+    worker.join();
+
+  if (parser.joinable())
+    parser.join();
+
+  for (auto& resolver : m_mapResolvers)
+    resolver.second.join();
+  m_mapResolvers.clear();
+
+  if (m_strMetricsFile.size())
+    m_metrics.WriteFile(m_strMetricsFile);
+
+  m_pBackend->Finish(!m_bCancelled && AllDrivesMapped(), m_pClock->Now() - m_iRunStart);
+
+  if (m_bCancelled)
+    return false;
+
+  if (AllDrivesMapped())
+    return true; // We're done
+
   std::cout << std::endl;
 
   return false;
 }
 
 
+// Start resolving all distinct server names concurrently
+void CWinMount::ResolveHosts(void)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  for (auto& netShare : m_deqNetShares)
+    StartResolve(netShare.GetHostName());
+}
+
+
+// Start resolving strHost in the background, unless that's already done or in progress. Names with an '@'
+// (WebDAV: server@SSL@port) aren't host names and aren't resolved. m_mutex must be held
+void CWinMount::StartResolve(const std::string& strHost)
+{
+  if (!m_nameCache.IsEnabled() || strHost.find('@') != std::string::npos || m_setResolving.count(strHost) ||
+      m_nameCache.Lookup(strHost, m_pClock->Now()) != CNameCache::STATE_UNKNOWN)
+    return;
+
+  // Virtual time has a single thread, resolve one host after the other
+  if (m_pClock->IsVirtual())
+  {
+    ResolveHost(strHost);
+    return;
+  }
+
+  // A previous resolution of the host has finished (it's no longer resolving), joining it only waits for it to return
+  std::thread& resolver = m_mapResolvers[strHost];
+  if (resolver.joinable())
+    resolver.join();
+
+  m_setResolving.insert(strHost);
+  resolver = std::thread([this, strHost]
+  {
+    ResolveHost(strHost);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_setResolving.erase(strHost);
+    m_cvDone.notify_all();
+  });
+}
+
+
+// Resolve strHost unless it's cached, returns false if it can't be resolved
+bool CWinMount::ResolveHost(const std::string& strHost)
+{
+  if (!m_nameCache.IsEnabled())
+    return true;
+
+  if (m_nameCache.Lookup(strHost, m_pClock->Now()) != CNameCache::STATE_UNKNOWN)
+    return m_nameCache.Resolve(strHost);
+
+  CTraceSpan span(m_trace, "resolve", "resolve");
+  span.AddArg("host", strHost);
+
+  const bool bResolved = m_nameCache.Resolve(strHost);
+  span.AddArg("result", bResolved ? "ok" : "failed");
+  if (!bResolved)
+    Print("  Unable to resolve host " + strHost);
+
+  return bResolved;
+}
+
+
+// Run queued connect attempts until MapDrives() is done
+void CWinMount::WorkerThread(void)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for (;;)
+  {
+    m_cvJobs.wait(lock, [this] { return m_bStopWorkers || !m_deqJobs.empty(); });
+    if (m_deqJobs.empty())
+      return; // Stop
+
+    const CJob job = m_deqJobs.front();
+    m_deqJobs.pop_front();
+    RunJob(job, lock);
+  }
+}
+
+
+// Make the connect attempt of job and apply its outcome. m_mutex must be held (it's released during the attempt)
+void CWinMount::RunJob(const CJob& job, std::unique_lock<std::mutex>& lock)
+{
+  // Name, host and policy of a share never change (nor does its address), so it's safe to use it unlocked
+  CNetShare& netShare = m_deqNetShares[job.iShare];
+  lock.unlock();
+  const EOutcome outcome = ConnectShare(netShare, job.bProbe);
+  lock.lock();
+
+  m_limiter.Release(netShare.GetHostName());
+  netShare.SetInFlight(false);
+
+  // A probe that got no answer from the host (result recorded) must not keep the breaker half-open forever,
+  // eg. when it's deferred for a credential dialog before it connected
+  if (job.bProbe)
+    GetBreaker(netShare.GetHostName()).AbortProbe();
+
+  if (outcome == OUTCOME_MAPPED)
+    m_metrics.ObserveTimeToMapped(m_pClock->Now() - m_iRunStart);
+
+  if (outcome == OUTCOME_MAPPED)
+  {
+    netShare.SetMapped();
+  }
+  else if (outcome == OUTCOME_FATAL)
+  {
+    netShare.SetFailed(); // Retrying won't help
+  }
+  else if (outcome == OUTCOME_CANCEL)
+  {
+    m_bCancelled = true;
+  }
+  else if (outcome == OUTCOME_DEFER)
+  {
+    netShare.SetAwaitingPrompt(); // Not a failure, no retry delay
+  }
+  else
+  {
+    uint64_t iNextDue = UINT64_MAX; // The scheduler picks this up itself
+    RetryLater(netShare, iNextDue, ShowError(netShare.GetLastResult()));
+  }
+
+  m_cvDone.notify_all();
+}
+
+
+// Failed: retry this share later (without holding back the others), or give up. m_mutex must be held
+void CWinMount::RetryLater(CNetShare& netShare, uint64_t& iNextDue, const std::string& strReason, const uint64_t iRetryAt /* = 0 */)
+{
+  netShare.ScheduleRetry(m_pClock->Now(), iRetryAt);
+  if (netShare.IsFailed())
+  {
+    GiveUp(netShare);
+  }
+  else
+  {
+    m_metrics.CountRetry();
+    iNextDue = std::min(iNextDue, netShare.GetNextAttempt());
+    if (m_trace.IsOpen())
+      netShare.SetRetryWait(true, m_trace.Now(), strReason);
+  }
+}
+
+
+// Stop retrying netShare. m_mutex must be held
+void CWinMount::GiveUp(CNetShare& netShare)
+{
+  netShare.SetFailed();
+  Print("  Giving up on " + netShare.GetRemoteName() + " after " + std::to_string(netShare.GetAttempts()) + " attempt(s)");
+}
+
+
+// Trace the wait of a share from RetryLater until it's dispatched again (on a track of its own). m_mutex must be held
+void CWinMount::TraceRetryWait(CNetShare& netShare, const size_t iShare)
+{
+  if (!netShare.IsRetryWaiting())
+    return;
+
+  std::vector<std::pair<std::string, std::string> > vecArgs;
+  vecArgs.push_back(std::make_pair("share", netShare.GetRemoteName()));
+  vecArgs.push_back(std::make_pair("drive", netShare.GetLocalName()));
+  vecArgs.push_back(std::make_pair("host", netShare.GetHostName()));
+  vecArgs.push_back(std::make_pair("last result", netShare.GetRetryReason()));
+  m_trace.AddAsyncSpan("retry wait", "wait", iShare, netShare.GetRetryWaitStart(), m_trace.Now(), vecArgs);
+
+  netShare.SetRetryWait(false);
+}
+
+
+// Print a complete line to the console
+void CWinMount::Print(const std::string& strLine)
+{
+  std::lock_guard<std::mutex> lock(m_consoleMutex);
+  std::cout << strLine << std::endl;
+}
+
+
+// Report an error, in a message box unless replaying
+void CWinMount::ErrorBox(const std::string& strMsg)
+{
+  if (m_bReplay)
+    Print("  (" + StringUtils::Trim(strMsg) + ")");
+  else
+    MessageBox(0, strMsg.c_str(), "Error", MB_OK + MB_ICONERROR);
+}
+
+
+// Tag a trace span with the share it applies to
+static void TraceShare(CTraceSpan& span, const CNetShare& netShare)
+{
+  span.AddArg("share", netShare.GetRemoteName());
+  span.AddArg("drive", netShare.GetLocalName());
+  span.AddArg("host", netShare.GetHostName());
+}
+
+
+// Tag a trace span with a result code
+static void TraceResult(CTraceSpan& span, const DWORD result)
+{
+  span.AddArg("result", std::to_string(result));
+  span.AddArg("error", ShowError(result));
+}
+
+
+DWORD CWinMount::AddConnection(CNetShare& netShare, const DWORD dwFlags, const std::string& strSpan)
+{
+  CTraceSpan span(m_trace, strSpan, "connect");
+  TraceShare(span, netShare);
+
+  const uint64_t iStart = m_pClock->Now();
+  const DWORD result = m_pBackend->AddConnection(netShare.GetLocalName(), netShare.GetRemoteName(), dwFlags);
+  TraceResult(span, result);
+  const DWORD dwLatency = (DWORD) (m_pClock->Now() - iStart);
+  m_metrics.CountAttempt(result, dwLatency);
+  RecordResult(netShare, result);
+
+  return result;
+}
+
+
+// Terminate any existing mount with the drive letter of netShare
+DWORD CWinMount::CancelConnection(const CNetShare& netShare)
+{
+  CTraceSpan span(m_trace, "unmount", "unmount");
+  TraceShare(span, netShare);
+
+  const DWORD result = m_pBackend->CancelConnection(netShare.GetLocalName());
+  TraceResult(span, result);
+
+  return result;
+}
+
+
+// Make a single connect attempt for netShare (on a worker thread, m_mutex not held)
+CWinMount::EOutcome CWinMount::ConnectShare(CNetShare& netShare, const bool bProbe)
+{
+  const std::string& strLocal = netShare.GetLocalName();
+  const std::string& strRemote = netShare.GetRemoteName();
+  const std::string strHost = netShare.GetHostName();
+  const CSharePolicy& policy = netShare.GetPolicy();
+  const std::string strConnecting = "> Connecting " + strRemote + " to " + strLocal + "...";
+
+  bool bTryInteractive = false;
+  const DWORD dwConnectFlags = (policy.bPersist ? NET_CONNECT_UPDATE_PROFILE : 0);
+
+  if (bProbe)
+    Print("> Probing host " + strHost);
+
+  if (m_bUnmount)
+  {
+    // Terminate any existing mounts with this drive letter
+    const DWORD result = CancelConnection(netShare);
+    if (result != NO_ERROR && result != ERROR_NOT_CONNECTED)
+    {
+      Print(strConnecting + "Unable to unmount existing connection");
+
+      const std::string strMsg = ShowError(result) + "\nUnable to disconnect " + strLocal;
+      ErrorBox(strMsg);
+
+      return OUTCOME_FATAL;
+    }
+  }
+
+  // Credentials were entered for this server before: try without a dialog first, using that session
+  bool bAuthenticated;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bAuthenticated = (m_setAuthenticated.count(strHost) > 0);
+  }
+
+  if (policy.interactive != INTERACTIVE_ALWAYS || bAuthenticated)
+  {
+    const DWORD result = AddConnection(netShare, dwConnectFlags, bProbe ? "probe" : "connect");
+    const EErrorClass errorClass = m_errorTable.Classify(result);
+
+    if (errorClass == ERROR_CLASS_SUCCESS)
+    {
+      Print(strConnecting + ShowError(result));
+      return OUTCOME_MAPPED;
+    }
+    else if (errorClass == ERROR_CLASS_CANCEL)
+    {
+      Print(strConnecting + ShowError(result));
+      return OUTCOME_CANCEL;
+    }
+    else if (errorClass == ERROR_CLASS_PERMANENT || (errorClass == ERROR_CLASS_CREDENTIALS && policy.interactive == INTERACTIVE_NEVER))
+    {
+      // Neither retrying nor interactive mode will help:
+      Print(strConnecting + "FATAL: " + ShowError(result));
+
+      const std::string strMsg = ShowError(result) + "\nUnable to connect " + strRemote + " to " + strLocal;
+      ErrorBox(strMsg);
+
+      return OUTCOME_FATAL;
+    }
+
+    // Only prompt when credentials are the problem, transient errors (eg. the host is unavailable) are just retried
+    if (errorClass == ERROR_CLASS_CREDENTIALS)
+    {
+      Print(strConnecting + "Non-fatal: " + ShowError(result) + ".\n  Retry in interactive mode...");
+      bTryInteractive = true;
+    }
+    else
+    {
+      Print(strConnecting + ShowError(result));
+    }
+  }
+
+  // (Try) interactive mode?
+  if (policy.interactive == INTERACTIVE_ALWAYS || bTryInteractive)
+  {
+    // Only one credential dialog at a time. Others wait for it without holding up a worker, and shares on
+    // the same server then reuse the session it sets up instead of prompting again
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (m_strPromptHost.size())
+      {
+        Print("  Waiting for the credential dialog for " + m_strPromptHost + "...");
+        return OUTCOME_DEFER;
+      }
+      m_strPromptHost = strHost;
+    }
+
+    // Call the WNetAddConnection2 function to assign a drive letter to the share (Prompt for username/pwd).
+    // A single dialog per attempt: when the host is unavailable, the share is retried like after any other
+    // failed attempt, so its retries, timeout and circuit breaker apply (and other dialogs get their turn)
+    const DWORD result = AddConnection(netShare, NET_CONNECT_INTERACTIVE | NET_CONNECT_PROMPT | dwConnectFlags, "connect (interactive)");
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_strPromptHost.clear();
+      if (result == NO_ERROR)
+        m_setAuthenticated.insert(strHost);
+    }
+
+    Print((bTryInteractive ? "  " : strConnecting) + ShowError(result));
+
+    const EErrorClass errorClass = m_errorTable.Classify(result);
+    if (errorClass == ERROR_CLASS_CANCEL)
+      return OUTCOME_CANCEL;
+    else if (errorClass == ERROR_CLASS_SUCCESS)
+      return OUTCOME_MAPPED;
+
+    const std::string strMsg = ShowError(result) + "\nUnable to connect " + strRemote + " to " + strLocal;
+    ErrorBox(strMsg);
+
+    // The credentials entered in the dialog were refused (eg. access denied): retrying would only prompt again
+    if (errorClass == ERROR_CLASS_PERMANENT || errorClass == ERROR_CLASS_CREDENTIALS)
+      return OUTCOME_FATAL;
+  }
+
+  return OUTCOME_RETRY;
+}
+
+
 // ** Program entry point **
+#ifndef WINMOUNT_NO_MAIN
 int main(int argc, char *argv[])
 {
   std::cout << "WinMount v" << VERSION << " - (C) Copyright 2002-2024" << std::endl;
@@ -417,3 +1452,4 @@ int main(int argc, char *argv[])
 
   return EXIT_SUCCESS; // Success :-)
 }
+#endif // WINMOUNT_NO_MAIN
@@ -3,32 +3,104 @@
 #include <string>
 #include <vector>
 #include <fstream> // For std::ifstream
+#include <map>
+#include <set>
+#include <thread>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
 
 #include <inttypes.h>
 #include <windows.h>
 
+#include "Clock.h"
+#include "CircuitBreaker.h"
+#include "TraceLog.h"
+#include "NetBackend.h"
+#include "HostLimiter.h"
+#include "HealthCache.h"
+#include "Resolver.h"
+#include "Metrics.h"
+#include "ErrorTable.h"
+
+// Interactive behaviour for a share
+enum EInteractive { INTERACTIVE_FALLBACK, INTERACTIVE_ALWAYS, INTERACTIVE_NEVER };
+
+// Per-share connection policy (defaults from the command line, optionally overridden in the mount file)
+struct CSharePolicy
+{
+  int iRetries = 0;                           // Max. number of attempts (0 = retry forever)
+  DWORD dwDelay = 0;                          // Delay in ms between attempts
+  DWORD dwTimeout = 0;                        // Give up after this many ms since the first attempt (0 = no limit)
+  bool bPersist = false;                      // Remember connection (NET_CONNECT_UPDATE_PROFILE)
+  EInteractive interactive = INTERACTIVE_FALLBACK;
+  int iPriority = 0;                          // Shares with a higher priority are connected first
+};
+
+
 class CNetShare
 {
   public:
-    CNetShare(const std::string& strLocal, const std::string& strRemote) { m_strLocalName = strLocal; m_strRemoteName = strRemote; }; // Constructor
+    CNetShare(const std::string& strLocal, const std::string& strRemote, const std::string& strHost, const CSharePolicy& policy)
+      { m_strLocalName = strLocal; m_strRemoteName = strRemote; m_strHostName = strHost; m_policy = policy; }; // Constructor
     ~CNetShare(void) {}; // Destructor (empty)
 
     bool IsMapped() const { return m_bMapped; };
     void SetMapped(const bool bMapped = true) { m_bMapped = bMapped; };
     std::string GetLocalName() const { return m_strLocalName; };
     std::string GetRemoteName() const { return m_strRemoteName; };
+    std::string GetHostName() const { return m_strHostName; };
+    const CSharePolicy& GetPolicy() const { return m_policy; };
+
+    bool IsFailed() const { return m_bFailed; };
+    void SetFailed(const bool bFailed = true) { m_bFailed = bFailed; };
+    bool IsDone() const { return m_bMapped || m_bFailed; };
+    bool IsInFlight() const { return m_bInFlight; };
+    void SetInFlight(const bool bInFlight = true) { m_bInFlight = bInFlight; };
+    bool IsAwaitingPrompt() const { return m_bAwaitingPrompt; };
+    void SetAwaitingPrompt(const bool bAwaiting = true) { m_bAwaitingPrompt = bAwaiting; };
+    int GetAttempts() const { return m_iAttempts; };
+    uint64_t GetFirstAttempt() const { return m_iFirstAttempt; };
+    uint64_t GetNextAttempt() const { return m_iNextAttempt; };
+    void StartAttempt(const uint64_t iNow) { if (!m_iAttempts++) m_iFirstAttempt = iNow; };
+    void ScheduleRetry(const uint64_t iNow, const uint64_t iRetryAt = 0);
+    bool IsExpired(const uint64_t iNow) const
+      { return m_policy.dwTimeout > 0 && m_iAttempts > 0 && iNow - m_iFirstAttempt >= m_policy.dwTimeout; };
+    uint64_t GetUnresolvedAttempt() const { return m_iUnresolvedAttempt; };
+    void SetUnresolvedAttempt(const uint64_t iExpires) { m_iUnresolvedAttempt = iExpires; };
+    DWORD GetLastResult() const { return m_dwLastResult; };
+    void SetLastResult(const DWORD result) { m_dwLastResult = result; };
+    bool IsRetryWaiting() const { return m_bRetryWaiting; };
+    uint64_t GetRetryWaitStart() const { return m_iRetryWaitStart; };
+    const std::string& GetRetryReason() const { return m_strRetryReason; };
+    void SetRetryWait(const bool bWaiting, const uint64_t iStart = 0, const std::string& strReason = "")
+      { m_bRetryWaiting = bWaiting; m_iRetryWaitStart = iStart; m_strRetryReason = strReason; };
 
   private:
     std::string m_strLocalName;
     std::string m_strRemoteName;
+    std::string m_strHostName;                // Server part of the remote name (lowercase)
+    CSharePolicy m_policy;
     bool m_bMapped = false;
+    bool m_bFailed = false;                   // Gave up (retries or timeout exhausted)
+    bool m_bInFlight = false;                 // A connect attempt is running on a worker thread
+    bool m_bAwaitingPrompt = false;           // Needs a credential dialog, waits for the one being shown
+    int m_iAttempts = 0;
+    uint64_t m_iFirstAttempt = 0;             // Tick count of the first attempt
+    uint64_t m_iNextAttempt = 0;              // Tick count before which no new attempt is made
+    uint64_t m_iUnresolvedAttempt = 0;        // Expiry of the failed name resolution of the last real attempt made despite it
+    DWORD m_dwLastResult = 0;                 // Result of the last connect call (written with m_mutex held)
+    bool m_bRetryWaiting = false;             // Waiting to be retried (traced when it's dispatched again)
+    uint64_t m_iRetryWaitStart = 0;           // Trace time at which the wait started
+    std::string m_strRetryReason;             // Why it's retried, for the trace
 };
 
 
 class CWinMount
 {
   public:
-    CWinMount(void) {};   // Constructor (empty)
+    // Constructor. A simulated run (eg. tests) supplies its own clock and/or backend, which it hands over
+    CWinMount(CClock* pClock = NULL, CNetBackend* pBackend = NULL) : m_pClock(pClock), m_pBackend(pBackend) {};
     ~CWinMount(void) {};  // Destructor (empty)
     bool ProcessCommandLine(const std::vector<std::string>& vecArgs);
     bool ProcessIniFile();
@@ -36,11 +108,88 @@ class CWinMount
     bool MapDrives();
 
   private:
+    // Outcome of a single connect attempt
+    enum EOutcome { OUTCOME_RETRY, OUTCOME_MAPPED, OUTCOME_FATAL, OUTCOME_CANCEL, OUTCOME_DEFER };
+
+    // Mount file entry that mapped a drive letter first
+    struct CDriveSource
+    {
+      std::string strRemote;
+      std::string strFile;
+    };
+
+    // Connect attempt queued for the worker threads (run inline in virtual time)
+    struct CJob
+    {
+      size_t iShare;
+      bool bProbe;
+    };
+
+    bool ParsePolicy(std::string& strRemote, CSharePolicy& policy) const;
+    bool ParseIniFiles(void);
+    bool ParseIniFile(const std::string& strFile, std::ifstream& fStream);
+    bool InvalidLine(const std::string& strFile, const int iLine, const std::string& strProblem);
+    bool AddShare(const CNetShare& netShare);
+    void WorkerThread(void);
+    void RunJob(const CJob& job, std::unique_lock<std::mutex>& lock);
+    void RetryLater(CNetShare& netShare, uint64_t& iNextDue, const std::string& strReason, const uint64_t iRetryAt = 0);
+    void GiveUp(CNetShare& netShare);
+    void TraceRetryWait(CNetShare& netShare, const size_t iShare);
+    EOutcome ConnectShare(CNetShare& netShare, const bool bProbe);
+    DWORD AddConnection(CNetShare& netShare, const DWORD dwFlags, const std::string& strSpan);
+    DWORD CancelConnection(const CNetShare& netShare);
+    void ErrorBox(const std::string& strMsg);
+    void Print(const std::string& strLine);
+    CCircuitBreaker& GetBreaker(const std::string& strHost);
+    void RecordResult(CNetShare& netShare, const DWORD result);
+    void ResolveHosts(void);
+    void StartResolve(const std::string& strHost);
+    bool ResolveHost(const std::string& strHost);
+    void CheckHealthCache(const std::string& strHost, CCircuitBreaker& breaker, const uint64_t iNow);
+
     bool m_bUnmount = false;
-    bool m_bRetryForever = false;
-    DWORD m_dwConnectFlags = 0;
+    bool m_bStream = false;                   // Start mapping while the mount file is being parsed (--stream)
+    bool m_bSkipInvalid = false;              // Skip invalid mount file lines instead of aborting (--on-parse-error)
+    bool m_bReplay = false;                   // Replaying a recorded run (--replay) or simulated backend, no dialogs
+    CSharePolicy m_defaultPolicy;             // Policy for shares without attributes in the mount file
+    int m_iBreakerThreshold = 3;              // Consecutive failures before a host is suspended (0 = disabled)
+    uint64_t m_iBreakerCoolDown = 10000;      // Time in ms before a suspended host is probed again
+    int m_iMaxConnects = 4;                   // Max. connect attempts in flight (= number of worker threads)
+    int m_iHostConnects = 2;                  // Max. connect attempts in flight per host
+    int m_iHostRate = 0;                      // Max. new connect attempts per second per host (0 = unlimited)
+    int m_iStartJitter = -1;                  // Max. random delay in ms before mapping starts (-1 = auto)
+    int m_iResolveTtl = 300;                  // Seconds a resolved host name is cached (0 = no pre-resolution)
+    std::string m_strResolverFile;            // Simulated name resolution (--resolver-file)
+    std::string m_strMetricsFile;             // Prometheus text file (--metrics-file)
+    int m_iMetricsInterval = 10;              // Seconds between metrics file updates
+    int m_iMetricsPort = 0;                   // Localhost HTTP port for metrics (0 = none)
+    uint64_t m_iRunStart = 0;                 // Tick count at which mapping started
+
+    std::vector<std::string> m_vecIniFiles;   // Mount files, in order of precedence
+    std::deque<std::ifstream> m_deqStreams;   // One per mount file
+    std::map<std::string, CDriveSource> m_mapDrives; // Where each drive letter was mapped (by the parser only)
+    std::deque<CNetShare> m_deqNetShares;     // Grows while mapping when streaming, elements never move
+    std::vector<size_t> m_vecOrder;           // Indexes in m_deqNetShares, highest priority first
+    std::unique_ptr<CClock> m_pClock;         // Engine time: wall clock or simulated (--virtual-clock)
+    std::map<std::string, CCircuitBreaker> m_mapBreakers; // Per-host circuit breakers
+    CTraceLog m_trace;                        // Timeline output (--trace)
+    std::unique_ptr<CNetBackend> m_pBackend;  // Connection backend (real, recording or replay)
+    CHostLimiter m_limiter;                   // Admission control for connect attempts
+    CHealthCache m_healthCache;               // Host health shared with other instances (--health-cache)
+    CNameCache m_nameCache;                   // Per-run cache of resolved host names (its resolver can use m_pBackend)
+    std::set<std::string> m_setResolving;     // Hosts with a pre-resolution in progress
+    std::map<std::string, std::thread> m_mapResolvers; // Last resolver thread per host (joined before the next one)
+    CErrorTable m_errorTable;                 // Result code classes (--error-class overrides), read-only while mapping
+    CMetrics m_metrics;                       // Instrumentation (--metrics-file/--metrics-port)
 
-    std::string m_strIniFile;                 // Location of the (mount) ini-file
-    std::ifstream m_fStream;
-    std::vector<CNetShare> m_vecNetShares;
+    std::mutex m_mutex;                       // Protects the share states, breakers, limiter and job queue
+    std::condition_variable m_cvJobs;         // Signalled when a job is queued (or the workers must stop)
+    std::condition_variable m_cvDone;         // Signalled when a job has finished
+    std::deque<CJob> m_deqJobs;
+    bool m_bStopWorkers = false;
+    bool m_bParsing = false;                  // The mount file is being parsed while mapping (--stream)
+    bool m_bCancelled = false;                // User cancelled (<ESC> or dialog) or aborted on a streamed parse error
+    std::string m_strPromptHost;              // Server a credential dialog is shown for (only one at a time)
+    std::set<std::string> m_setAuthenticated; // Servers with a session set up through a credential dialog
+    std::mutex m_consoleMutex;                // Keep console lines of concurrent attempts apart
 };
@@ -0,0 +1,87 @@
+// Circuit breaker state transitions
+
+#include "Test.h"
+#include "CircuitBreaker.h"
+
+static void TestOpenAndProbe(void)
+{
+  CCircuitBreaker breaker(2, 1000);
+
+  CHECK(breaker.AllowAttempt(0));
+  breaker.RecordFailure(0);
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_CLOSED);
+  breaker.RecordFailure(100);
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_OPEN);
+
+  CHECK(!breaker.AllowAttempt(500));   // Cooling down
+  CHECK(breaker.AllowAttempt(1100));   // Probe
+  CHECK(breaker.IsProbing());
+  CHECK(!breaker.AllowAttempt(1100));  // Only one probe at a time
+
+  breaker.RecordFailure(1200);         // Failed probe re-opens
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_OPEN);
+  CHECK(!breaker.AllowAttempt(2100));
+  CHECK(breaker.AllowAttempt(2200));
+
+  breaker.RecordSuccess();
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_CLOSED);
+  CHECK(breaker.AllowAttempt(2200));
+}
+
+
+// A probe that ends without a result must not block later probes
+static void TestAbortedProbe(void)
+{
+  CCircuitBreaker breaker(1, 1000);
+
+  breaker.RecordFailure(0);
+  CHECK(breaker.AllowAttempt(1000));
+  CHECK(!breaker.AllowAttempt(1000));
+
+  breaker.AbortProbe();
+  CHECK(breaker.IsProbing());
+  CHECK(breaker.AllowAttempt(1000));   // Next attempt probes instead
+
+  breaker.RecordSuccess();
+  breaker.AbortProbe();                // No-op once the probe was answered
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_CLOSED);
+}
+
+
+// Another process reaching the host ends the cool-down early, with a single probe
+static void TestEndCoolDown(void)
+{
+  CCircuitBreaker breaker(1, 1000);
+
+  breaker.EndCoolDown();               // No-op while closed
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_CLOSED);
+
+  breaker.RecordFailure(0);
+  CHECK(!breaker.AllowAttempt(100));
+  breaker.EndCoolDown();
+  CHECK(breaker.AllowAttempt(100));
+  CHECK(!breaker.AllowAttempt(100));
+}
+
+
+static void TestDisabled(void)
+{
+  CCircuitBreaker breaker(0, 1000);
+
+  for (int i = 0; i < 10; i++)
+    breaker.RecordFailure(i);
+
+  CHECK_EQUAL(breaker.GetState(), CCircuitBreaker::STATE_CLOSED);
+  CHECK(breaker.AllowAttempt(10));
+}
+
+
+int main(void)
+{
+  TestOpenAndProbe();
+  TestAbortedProbe();
+  TestEndCoolDown();
+  TestDisabled();
+
+  return TEST_RESULT();
+}
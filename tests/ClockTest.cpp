@@ -0,0 +1,80 @@
+// Virtual and system clocks
+
+#include "Test.h"
+#include "Clock.h"
+
+#include <thread>
+#include <vector>
+
+static void TestVirtualClock(void)
+{
+  CVirtualClock clock;
+  CHECK(clock.IsVirtual());
+  CHECK_EQUAL(clock.Now(), 0u);
+
+  clock.Sleep(250);
+  CHECK_EQUAL(clock.Now(), 250u);
+
+  // Waits never block, they just move time on by the full timeout
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::unique_lock<std::mutex> lock(mutex);
+  clock.WaitFor(cv, lock, 10000);
+  CHECK_EQUAL(clock.Now(), 10250u);
+  CHECK(lock.owns_lock());
+
+  clock.Sleep(0);
+  CHECK_EQUAL(clock.Now(), 10250u);
+}
+
+
+// Concurrent sleeps all count
+static void TestVirtualClockThreads(void)
+{
+  CVirtualClock clock;
+
+  std::vector<std::thread> vecThreads;
+  for (int i = 0; i < 4; i++)
+  {
+    vecThreads.push_back(std::thread([&clock]
+    {
+      for (int j = 0; j < 1000; j++)
+        clock.Sleep(1);
+    }));
+  }
+
+  for (auto& thread : vecThreads)
+    thread.join();
+
+  CHECK_EQUAL(clock.Now(), 4000u);
+}
+
+
+static void TestSystemClock(void)
+{
+  CSystemClock clock;
+  CHECK(!clock.IsVirtual());
+
+  const uint64_t iStart = clock.Now();
+  clock.Sleep(20);
+  CHECK(clock.Now() - iStart >= 20);
+
+  // A wait that isn't signalled times out
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::unique_lock<std::mutex> lock(mutex);
+  const uint64_t iWait = clock.Now();
+  clock.WaitFor(cv, lock, 20);
+  CHECK(clock.Now() - iWait >= 19);
+  CHECK(lock.owns_lock());
+}
+
+
+int main(void)
+{
+  TestVirtualClock();
+  TestVirtualClockThreads();
+  TestSystemClock();
+
+  return TEST_RESULT();
+}
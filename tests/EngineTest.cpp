@@ -0,0 +1,336 @@
+// The mapping engine against a scripted backend and resolver: randomized scenarios in simulated time,
+// credential dialogs in real time (with worker threads)
+
+#include "Test.h"
+#include "WinMount.h"
+#include "ScriptedBackend.h"
+
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <cstdio>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+enum EHost { HOST_UP, HOST_DOWN, HOST_UNRESOLVED };
+enum EShare { SHARE_OK, SHARE_PERMANENT, SHARE_CREDENTIALS, SHARE_REFUSED };
+
+struct CShareSpec
+{
+  std::string strLocal;
+  std::string strRemote;
+  EHost host;
+  EShare share;
+  int iRetries;
+  int iFailures;                              // Transient failures before an OK share connects
+};
+
+
+static const NetResult RESULT_BUSY = 170;          // Transient, the host is up
+static const NetResult RESULT_UNREACHABLE = 1231;  // The host is down
+static const NetResult RESULT_LOGON_FAILURE = 1326;
+static const uint64_t NEGATIVE_TTL = 10000;        // Name cache TTL of a failed resolution
+
+// Build and run one random scenario, then check what the engine did against what the scripts allow
+static void RunScenario(const unsigned int iSeed, const bool bRetryForever)
+{
+  std::mt19937 random(iSeed);
+  auto Pick = [&random](const int iMin, const int iMax) { return iMin + (int) (random() % (unsigned int) (iMax - iMin + 1)); };
+
+  const std::string strIniFile = "engine_test.ini";
+  const std::string strResolverFile = "engine_test_resolver.txt";
+
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = new CScriptedBackend(*pClock);
+
+  // Hosts: up, down or unresolvable (and down), only up with --retry (which never gives up)
+  const int iHosts = Pick(1, 4);
+  std::vector<EHost> vecHosts;
+  std::ofstream fResolver(strResolverFile);
+  for (int i = 0; i < iHosts; i++)
+  {
+    const EHost host = bRetryForever ? HOST_UP : (EHost) Pick(0, 2);
+    vecHosts.push_back(host);
+    fResolver << "srv" << i << (host == HOST_UNRESOLVED ? " fail " : " ok ") << Pick(0, 200) << "\n";
+  }
+  fResolver.close();
+
+  const int iDelay = Pick(1, 3);
+  const int iCoolDown = Pick(1, 5);
+  const uint32_t iMaxLatency = 500;
+
+  std::vector<CShareSpec> vecShares;
+  std::ofstream fIni(strIniFile);
+  const int iShares = Pick(1, 8);
+  for (int i = 0; i < iShares; i++)
+  {
+    CShareSpec spec;
+    const int iHost = Pick(0, iHosts - 1);
+    spec.strLocal = std::string(1, (char) ('g' + i)) + ":";
+    spec.strRemote = "\\\\srv" + std::to_string(iHost) + "\\share" + std::to_string(i);
+    spec.host = vecHosts[iHost];
+    spec.share = (EShare) Pick(0, 3);
+    spec.iRetries = Pick(1, 5);
+    spec.iFailures = Pick(0, 4);
+
+    std::vector<NetResult> vecResults;
+    NetResult iDialog = NET_RESULT_OK;
+    if (spec.host != HOST_UP)
+      vecResults.push_back(RESULT_UNREACHABLE);
+    else if (spec.share == SHARE_PERMANENT)
+      vecResults.push_back(NET_RESULT_BAD_NET_NAME);
+    else if (spec.share == SHARE_CREDENTIALS)
+      vecResults.push_back(RESULT_LOGON_FAILURE);
+    else if (spec.share == SHARE_REFUSED)
+    {
+      vecResults.push_back(RESULT_LOGON_FAILURE);
+      iDialog = RESULT_LOGON_FAILURE;         // The credentials entered in the dialog are refused too
+    }
+    else
+    {
+      vecResults.assign(spec.iFailures, RESULT_BUSY);
+      vecResults.push_back(NET_RESULT_OK);
+    }
+    pBackend->SetScript(spec.strRemote, vecResults, iDialog, (uint32_t) Pick(0, iMaxLatency));
+
+    fIni << spec.strLocal << " " << spec.strRemote << " | delay=" << iDelay;
+    if (!bRetryForever)
+      fIni << " retries=" << spec.iRetries;
+    fIni << "\n";
+
+    vecShares.push_back(spec);
+  }
+  fIni.close();
+
+  std::vector<std::string> vecArgs;
+  vecArgs.push_back("--start-jitter=0");
+  vecArgs.push_back("--resolver-file=" + strResolverFile);
+  vecArgs.push_back("--breaker-threshold=" + std::to_string(Pick(0, 3)));
+  vecArgs.push_back("--breaker-cooldown=" + std::to_string(iCoolDown));
+  vecArgs.push_back("--max-connects=" + std::to_string(Pick(1, 4)));
+  vecArgs.push_back("--host-connects=" + std::to_string(Pick(1, 2)));
+  if (bRetryForever)
+    vecArgs.push_back("--retry");
+  vecArgs.push_back(strIniFile);
+
+  // Keep the engine quiet, unless the scenario fails
+  std::ostringstream out;
+  std::streambuf* pOld = std::cout.rdbuf(out.rdbuf());
+
+  bool bStarted = false;
+  {
+    CWinMount winMount(pClock, pBackend);
+    bStarted = winMount.ProcessCommandLine(vecArgs) && winMount.ProcessIniFile();
+    if (bStarted)
+      winMount.MapDrives();
+
+    std::cout.rdbuf(pOld);
+    CHECK(bStarted);
+
+    // The run has terminated (we got here) and finished the backend
+    CHECK(pBackend->m_bFinished);
+
+    uint64_t iAttempts = 0;
+    bool bAllMappable = true;
+    for (const CShareSpec& spec : vecShares)
+    {
+      const size_t iCalls = pBackend->GetCalls(spec.strRemote);
+      iAttempts += (bRetryForever ? spec.iFailures + 1 : spec.iRetries);
+
+      bool bMappable = false;
+      if (spec.host != HOST_UP)
+        CHECK(iCalls <= (size_t) spec.iRetries);
+      else if (spec.share == SHARE_PERMANENT)
+        CHECK_EQUAL(iCalls, 1u);              // Not retried
+      else if (spec.share == SHARE_CREDENTIALS)
+      {
+        CHECK_EQUAL(iCalls, 2u);              // Failed logon, then the dialog
+        bMappable = true;
+      }
+      else if (spec.share == SHARE_REFUSED)
+        CHECK_EQUAL(iCalls, 2u);              // Failed logon, then a failed dialog: not retried
+      else if (bRetryForever || spec.iFailures < spec.iRetries)
+      {
+        CHECK_EQUAL(iCalls, (size_t) spec.iFailures + 1);
+        bMappable = true;
+      }
+      else
+        CHECK_EQUAL(iCalls, (size_t) spec.iRetries);
+
+      bAllMappable = bAllMappable && bMappable;
+    }
+
+    CHECK_EQUAL(winMount.AllDrivesMapped(), bAllMappable);
+    CHECK_EQUAL(pBackend->m_bAllMapped, bAllMappable);
+
+    // Each attempt costs at most two calls (with a dialog), a resolution and the longest wait before the next one
+    const uint64_t iMaxWait = std::max((uint64_t) std::max(iDelay, iCoolDown) * 1000, NEGATIVE_TTL);
+    CHECK(pBackend->m_iElapsed <= iAttempts * (2 * iMaxLatency + 200 + iMaxWait));
+
+    if (g_iFailures)
+      std::cerr << "Scenario " << iSeed << (bRetryForever ? " (--retry)" : "") << " failed:\n" << out.str() << std::endl;
+  }
+
+  std::remove(strIniFile.c_str());
+  std::remove(strResolverFile.c_str());
+}
+
+
+// Run the engine on a single mount file (in the time of the clock it was given), keeping it quiet
+static void RunMountFile(CWinMount& winMount, const std::string& strMountFile, std::vector<std::string> vecArgs)
+{
+  const std::string strIniFile = "engine_test.ini";
+  std::ofstream(strIniFile) << strMountFile;
+  vecArgs.push_back(strIniFile);
+
+  std::ostringstream out;
+  std::streambuf* pOld = std::cout.rdbuf(out.rdbuf());
+  const bool bStarted = winMount.ProcessCommandLine(vecArgs) && winMount.ProcessIniFile();
+  if (bStarted)
+    winMount.MapDrives();
+  std::cout.rdbuf(pOld);
+
+  CHECK(bStarted);
+  std::remove(strIniFile.c_str());
+}
+
+
+// Only host-down results count towards the circuit breaker: transient results in between don't close it,
+// and "network path not found" (53) is a host-down result
+static void TestBreakerResults(void)
+{
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = new CScriptedBackend(*pClock);
+  pBackend->SetScript("\\\\srv\\share", { RESULT_UNREACHABLE, RESULT_BUSY, RESULT_UNREACHABLE, NET_RESULT_OK }, NET_RESULT_OK, 10);
+  pBackend->SetScript("\\\\dead\\share", { 53 }, NET_RESULT_OK, 10);
+
+  CWinMount winMount(pClock, pBackend);
+  RunMountFile(winMount, "g: \\\\srv\\share | retries=5 delay=1\nh: \\\\dead\\share | retries=5 delay=1\n",
+               { "--breaker-threshold=2", "--breaker-cooldown=60" });
+
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\share"), 3u);   // Suspended after the second host-down result
+  CHECK_EQUAL(pBackend->GetCalls("\\\\dead\\share"), 2u);
+  CHECK(!winMount.AllDrivesMapped());
+}
+
+
+// A failed resolution doesn't stop a share from being tried: the backend may know the name
+static void TestUnresolvedHost(void)
+{
+  const std::string strResolverFile = "engine_test_resolver.txt";
+  std::ofstream(strResolverFile) << "srv fail\nsrv@ssl@8443 fail\n";
+
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = new CScriptedBackend(*pClock);
+  pBackend->SetScript("\\\\srv\\share", { NET_RESULT_OK }, NET_RESULT_OK, 10);
+  pBackend->SetScript("\\\\srv@SSL@8443\\DavWWWRoot", { RESULT_BUSY, NET_RESULT_OK }, NET_RESULT_OK, 10);
+
+  CWinMount winMount(pClock, pBackend);
+  RunMountFile(winMount, "g: \\\\srv\\share | retries=3\nh: \\\\srv@SSL@8443\\DavWWWRoot | retries=2 delay=1\n",
+               { "--resolver-file=" + strResolverFile });
+
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\share"), 1u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv@SSL@8443\\DavWWWRoot"), 2u);   // Not resolved at all
+  CHECK(winMount.AllDrivesMapped());
+  CHECK(pBackend->m_iElapsed < 2000);
+
+  std::remove(strResolverFile.c_str());
+}
+
+
+// A successful dialog sets up a session with srva, which later calls to it use. The user only answers that
+// dialog once \\srvb\plain has connected again, which it mustn't wait for
+class CDialogBackend : public CScriptedBackend
+{
+  public:
+    CDialogBackend(CClock& clock) : CScriptedBackend(clock) {};
+
+    NetResult AddConnection(const std::string& strLocal, const std::string& strRemote, const uint32_t iFlags)
+    {
+      const bool bServerA = (strRemote.find("\\\\srva\\") == 0);
+      if (bServerA && (iFlags & NET_CONNECT_INTERACTIVE))
+      {
+        for (int i = 0; i < 500 && GetCalls("\\\\srvb\\plain") < 2; i++)
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        m_bBlocked = (GetCalls("\\\\srvb\\plain") < 2);
+      }
+
+      const NetResult result = CScriptedBackend::AddConnection(strLocal, strRemote, iFlags);
+      if (bServerA && (iFlags & NET_CONNECT_INTERACTIVE) && result == NET_RESULT_OK)
+        m_bSessionA = true;
+      else if (bServerA && m_bSessionA)
+        return NET_RESULT_OK;
+
+      return result;
+    };
+
+    std::atomic<bool> m_bBlocked{false};
+
+  private:
+    std::atomic<bool> m_bSessionA{false};
+};
+
+
+// A single credential dialog per server: shares waiting for it reuse its session, shares of other servers
+// keep connecting while it's shown
+static void TestCredentialDialogs(void)
+{
+  CSystemClock* pClock = new CSystemClock;
+  CDialogBackend* pBackend = new CDialogBackend(*pClock);
+  const std::vector<std::string> vecServerA = { "\\\\srva\\one", "\\\\srva\\two", "\\\\srva\\three" };
+  for (auto& strRemote : vecServerA)
+    pBackend->SetScript(strRemote, { RESULT_LOGON_FAILURE }, NET_RESULT_OK, 10);
+  pBackend->SetScript("\\\\srvb\\secret", { RESULT_LOGON_FAILURE }, NET_RESULT_OK, 10);
+  pBackend->SetScript("\\\\srvb\\plain", { RESULT_BUSY, NET_RESULT_OK }, NET_RESULT_OK, 10);
+
+  CWinMount winMount(pClock, pBackend);
+  RunMountFile(winMount, "g: \\\\srva\\one\nh: \\\\srva\\two\ni: \\\\srva\\three\n"
+                         "j: \\\\srvb\\secret\nk: \\\\srvb\\plain | delay=1\n", { "--resolve-ttl=0" });
+
+  size_t iDialogs = 0;
+  for (auto& strRemote : vecServerA)
+    iDialogs += pBackend->GetDialogs(strRemote);
+  CHECK_EQUAL(iDialogs, 1u);
+  CHECK_EQUAL(pBackend->GetDialogs("\\\\srvb\\secret"), 1u);
+  CHECK(!pBackend->m_bBlocked);
+  CHECK(winMount.AllDrivesMapped());
+}
+
+
+// A dialog that finds the host unavailable ends the attempt, the share's retries apply (no dialog loop)
+static void TestDialogHostDown(void)
+{
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = new CScriptedBackend(*pClock);
+  pBackend->SetScript("\\\\srv\\always", { NET_RESULT_OK }, 66, 10);
+  pBackend->SetScript("\\\\srv\\fallback", { RESULT_LOGON_FAILURE }, RESULT_UNREACHABLE, 10);
+
+  CWinMount winMount(pClock, pBackend);
+  RunMountFile(winMount, "g: \\\\srv\\always | interactive=always retries=2 delay=1\n"
+                         "h: \\\\srv\\fallback | retries=3 delay=1\n", { "--breaker-threshold=0" });
+
+  CHECK_EQUAL(pBackend->GetDialogs("\\\\srv\\always"), 2u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\always"), 2u);
+  CHECK_EQUAL(pBackend->GetDialogs("\\\\srv\\fallback"), 3u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\fallback"), 6u);
+  CHECK(!winMount.AllDrivesMapped());
+}
+
+
+int main(void)
+{
+  TestBreakerResults();
+  TestUnresolvedHost();
+  TestCredentialDialogs();
+  TestDialogHostDown();
+
+  for (unsigned int iSeed = 1; iSeed <= 200 && !g_iFailures; iSeed++)
+  {
+    RunScenario(iSeed, false);
+    RunScenario(iSeed, true);
+  }
+
+  return TEST_RESULT();
+}
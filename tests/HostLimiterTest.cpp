@@ -0,0 +1,65 @@
+// Admission control: connection slots and the per-host token bucket
+
+#include "Test.h"
+#include "HostLimiter.h"
+
+static void TestSlots(void)
+{
+  CHostLimiter limiter;
+  limiter.SetLimits(3, 2, 0.0);
+
+  CHECK(limiter.CanAcquire("a", 0));
+  limiter.Acquire("a", 0);
+  limiter.Acquire("a", 0);
+  CHECK(!limiter.CanAcquire("a", 0));   // Per host cap
+  CHECK(limiter.CanAcquire("b", 0));
+  limiter.Acquire("b", 0);
+  CHECK_EQUAL(limiter.GetInFlight(), 3);
+  CHECK(!limiter.CanAcquire("c", 0));   // Total cap
+
+  limiter.Release("a");
+  CHECK(limiter.CanAcquire("a", 0));
+  CHECK(limiter.CanAcquire("c", 0));
+
+  limiter.Release("c");                 // Nothing in flight for c: ignored
+  CHECK_EQUAL(limiter.GetInFlight(), 2);
+
+  // Unlimited rate: a token is always available
+  CHECK_EQUAL(limiter.GetNextToken("a", 1234), 1234u);
+}
+
+
+static void TestRate(void)
+{
+  CHostLimiter limiter;
+  limiter.SetLimits(10, 2, 2.0);        // Burst of 2, then one attempt per 500 ms
+
+  limiter.Acquire("a", 0);
+  limiter.Release("a");
+  limiter.Acquire("a", 0);
+  limiter.Release("a");
+  CHECK(!limiter.CanAcquire("a", 0));   // Burst used up
+
+  const uint64_t iNext = limiter.GetNextToken("a", 0);
+  CHECK(iNext >= 500 && iNext <= 501);
+  CHECK(!limiter.CanAcquire("a", 400));
+  CHECK(limiter.CanAcquire("a", iNext));
+  CHECK(limiter.CanAcquire("b", 0));    // Other hosts have their own bucket
+
+  // The bucket never holds more than the burst
+  CHECK(limiter.CanAcquire("a", 100000));
+  limiter.Acquire("a", 100000);
+  limiter.Release("a");
+  limiter.Acquire("a", 100000);
+  limiter.Release("a");
+  CHECK(!limiter.CanAcquire("a", 100000));
+}
+
+
+int main(void)
+{
+  TestSlots();
+  TestRate();
+
+  return TEST_RESULT();
+}
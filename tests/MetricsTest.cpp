@@ -0,0 +1,30 @@
+// Metrics counters and their export
+
+#include "Test.h"
+#include "Metrics.h"
+
+#include <string>
+
+// Instances created one after the other at the same address each count in a block of their own
+static void TestReusedAddress(void)
+{
+  for (int i = 0; i < 3; i++)
+  {
+    CMetrics metrics;
+    metrics.Enable();
+    metrics.CountRetry();
+    metrics.CountAttempt(1231, 100);
+
+    const std::string strExport = metrics.Export();
+    CHECK(strExport.find("winmount_retries_total 1\n") != std::string::npos);
+    CHECK(strExport.find("winmount_connect_attempts_total{result=\"1231\"} 1\n") != std::string::npos);
+  }
+}
+
+
+int main(void)
+{
+  TestReusedAddress();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,209 @@
+// Reading mount files against a scripted backend: merging, duplicates and directories (in simulated time)
+// and streaming (in real time, while connecting)
+
+#include "Test.h"
+#include "WinMount.h"
+#include "ScriptedBackend.h"
+
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Run the engine on the given arguments, keeping it quiet (its output goes to *pOutput if given).
+// Returns the result of MapDrives()
+static bool RunEngine(CWinMount& winMount, const std::vector<std::string>& vecArgs, std::string* pOutput = NULL)
+{
+  std::ostringstream out;
+  std::streambuf* pOld = std::cout.rdbuf(out.rdbuf());
+  const bool bStarted = winMount.ProcessCommandLine(vecArgs) && winMount.ProcessIniFile();
+  const bool bMapped = bStarted && winMount.MapDrives();
+  std::cout.rdbuf(pOld);
+
+  if (pOutput)
+    *pOutput = out.str();
+
+  CHECK(bStarted);
+  return bMapped;
+}
+
+
+static void MakeDir(const std::string& strDir)
+{
+#ifdef _WIN32
+  _mkdir(strDir.c_str());
+#else
+  mkdir(strDir.c_str(), 0700);
+#endif
+}
+
+
+static void RemoveDir(const std::string& strDir)
+{
+#ifdef _WIN32
+  _rmdir(strDir.c_str());
+#else
+  rmdir(strDir.c_str());
+#endif
+}
+
+
+// Backend on which every share connects right away
+static CScriptedBackend* NewBackend(CClock& clock, const std::vector<std::string>& vecRemotes)
+{
+  CScriptedBackend* pBackend = new CScriptedBackend(clock);
+  for (auto& strRemote : vecRemotes)
+    pBackend->SetScript(strRemote, { NET_RESULT_OK }, NET_RESULT_OK, 10);
+
+  return pBackend;
+}
+
+
+// Files are merged in the order given: a later file can't remap a drive letter (it's skipped with a warning,
+// mapping goes on), identical entries are dropped, drive letters are case insensitive
+static void TestMerge(void)
+{
+  std::ofstream("site.ini") << "h: \\\\srv\\home\ng: \\\\srv\\data\n";
+  std::ofstream("pers.ini") << "h: \\\\other\\me\ni: \\\\srv\\extra\nG: \\\\SRV\\data\n";
+
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = NewBackend(*pClock, { "\\\\srv\\home", "\\\\other\\me", "\\\\srv\\data", "\\\\srv\\extra" });
+  CWinMount winMount(pClock, pBackend);
+  std::string strOutput;
+  CHECK(RunEngine(winMount, { "site.ini", "pers.ini" }, &strOutput));
+
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\home"), 1u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\other\\me"), 0u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\data"), 1u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\SRV\\data"), 0u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\extra"), 1u);
+  CHECK(strOutput.find("WARNING: Line 1 in config-file pers.ini maps h: which is already mapped to \\\\srv\\home by site.ini, skipped") != std::string::npos);
+  CHECK(strOutput.find("Line 3 in config-file pers.ini") == std::string::npos);
+
+  std::remove("site.ini");
+  std::remove("pers.ini");
+}
+
+
+// A drive letter mapped again in the same file keeps its first entry
+static void TestDuplicateInFile(void)
+{
+  std::ofstream("dup.ini") << "g: \\\\srv\\a\ng: \\\\srv\\b\ng: \\\\srv\\a\n";
+
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = NewBackend(*pClock, { "\\\\srv\\a", "\\\\srv\\b" });
+  CWinMount winMount(pClock, pBackend);
+  std::string strOutput;
+  CHECK(RunEngine(winMount, { "dup.ini" }, &strOutput));
+
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\a"), 1u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\b"), 0u);
+  CHECK(strOutput.find("WARNING: Line 2 in config-file dup.ini maps g:") != std::string::npos);
+  CHECK(strOutput.find("Line 3 in config-file dup.ini") == std::string::npos);
+
+  std::remove("dup.ini");
+}
+
+
+// A directory stands for the mount files (*.ini) in it, in case insensitive name order
+static void TestDirectory(void)
+{
+  const std::string strDir = "mount_test_dir";
+  MakeDir(strDir);
+  std::ofstream(strDir + "/b.ini") << "h: \\\\srv\\b\n";
+  std::ofstream(strDir + "/A.ini") << "h: \\\\srv\\a\ng: \\\\srv\\g\n";
+  std::ofstream(strDir + "/c.txt") << "i: \\\\srv\\c\n";
+
+  CVirtualClock* pClock = new CVirtualClock;
+  CScriptedBackend* pBackend = NewBackend(*pClock, { "\\\\srv\\a", "\\\\srv\\b", "\\\\srv\\c", "\\\\srv\\g" });
+  CWinMount winMount(pClock, pBackend);
+  CHECK(RunEngine(winMount, { strDir + "/" }));
+
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\a"), 1u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\b"), 0u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\c"), 0u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\g"), 1u);
+
+  std::remove((strDir + "/A.ini").c_str());
+  std::remove((strDir + "/b.ini").c_str());
+  std::remove((strDir + "/c.txt").c_str());
+  RemoveDir(strDir);
+}
+
+
+// Streaming with --on-parse-error=continue: the invalid last line is skipped, the run completes
+static void TestStreamContinue(void)
+{
+  const std::string strIniFile = "stream_test.ini";
+  std::ofstream(strIniFile) << "g: \\\\srv\\a\nh: \\\\srv\\b\ninvalid line\n";
+
+  CSystemClock* pClock = new CSystemClock;
+  CScriptedBackend* pBackend = new CScriptedBackend(*pClock);
+  pBackend->SetScript("\\\\srv\\a", { NET_RESULT_OK }, NET_RESULT_OK, 20);
+  pBackend->SetScript("\\\\srv\\b", { NET_RESULT_OK }, NET_RESULT_OK, 20);
+
+  CWinMount winMount(pClock, pBackend);
+  CHECK(RunEngine(winMount, { "--stream", "--on-parse-error=continue", strIniFile }));
+  CHECK(winMount.AllDrivesMapped());
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\a"), 1u);
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\b"), 1u);
+
+  std::remove(strIniFile.c_str());
+}
+
+
+// Streaming with --on-parse-error=abort (the default): a share mapped before the invalid line was read stays
+// mapped, the run fails. A named pipe holds the invalid line back until the share has been connected
+static void TestStreamAbort(void)
+{
+#ifndef _WIN32
+  const std::string strIniFile = "stream_test.fifo";
+  std::remove(strIniFile.c_str());
+  CHECK(mkfifo(strIniFile.c_str(), 0600) == 0);
+
+  CSystemClock* pClock = new CSystemClock;
+  CScriptedBackend* pBackend = new CScriptedBackend(*pClock);
+  pBackend->SetScript("\\\\srv\\a", { NET_RESULT_OK }, NET_RESULT_OK, 20);
+
+  std::thread writer([pBackend, &strIniFile]
+  {
+    std::ofstream fStream(strIniFile);
+    fStream << "g: \\\\srv\\a" << std::endl;
+
+    for (int i = 0; i < 500 && !pBackend->GetCalls("\\\\srv\\a"); i++)
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    fStream << "invalid line" << std::endl;
+  });
+
+  CWinMount winMount(pClock, pBackend);
+  CHECK(!RunEngine(winMount, { "--stream", strIniFile }));
+  writer.join();
+
+  CHECK(winMount.AllDrivesMapped());
+  CHECK_EQUAL(pBackend->GetCalls("\\\\srv\\a"), 1u);
+  CHECK(pBackend->m_bFinished && !pBackend->m_bAllMapped);
+
+  std::remove(strIniFile.c_str());
+#endif
+}
+
+
+int main(void)
+{
+  TestMerge();
+  TestDuplicateInFile();
+  TestDirectory();
+  TestStreamContinue();
+  TestStreamAbort();
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,173 @@
+// Record/replay round trips on the portable backend interface
+
+#include "Test.h"
+#include "NetBackend.h"
+
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+
+// Scripted backend: returns the given results in order, then keeps returning the last one
+class CScriptBackend : public CNetBackend
+{
+  public:
+    CScriptBackend(const std::vector<NetResult>& vecResults) : m_vecResults(vecResults) {};
+
+    NetResult AddConnection(const std::string&, const std::string&, const uint32_t) { return Next(); };
+    NetResult CancelConnection(const std::string&) { return Next(); };
+
+  private:
+    NetResult Next(void) { return m_vecResults[m_iNext < m_vecResults.size() - 1 ? m_iNext++ : m_iNext]; };
+
+    std::vector<NetResult> m_vecResults;
+    size_t m_iNext = 0;
+};
+
+
+// Scripted resolver: returns the given results in order, then keeps returning the last one
+class CScriptResolver : public CResolver
+{
+  public:
+    CScriptResolver(const std::vector<bool>& vecResults) : m_vecResults(vecResults) {};
+
+    bool Resolve(const std::string&) { return m_vecResults[m_iNext < m_vecResults.size() - 1 ? m_iNext++ : m_iNext]; };
+
+  private:
+    std::vector<bool> m_vecResults;
+    size_t m_iNext = 0;
+};
+
+
+static std::string Finish(CReplayBackend& replay, const bool bAllMapped, const uint64_t iElapsed)
+{
+  std::ostringstream out;
+  std::streambuf* pOld = std::cout.rdbuf(out.rdbuf());
+  replay.Finish(bAllMapped, iElapsed);
+  std::cout.rdbuf(pOld);
+
+  return out.str();
+}
+
+
+static void TestRoundTrip(void)
+{
+  const char* szFile = "replay_roundtrip.txt";
+  {
+    CRecordingBackend recorder(new CScriptBackend({ 1231, 53, NET_RESULT_OK }));
+    CHECK(recorder.Open(szFile));
+    CHECK_EQUAL(recorder.AddConnection("G:", "\\\\srv\\share", 0), 1231u);
+    CHECK_EQUAL(recorder.AddConnection("G:", "\\\\srv\\share", 0), 53u);
+    CHECK_EQUAL(recorder.AddConnection("G:", "\\\\srv\\share", NET_CONNECT_INTERACTIVE | NET_CONNECT_PROMPT), NET_RESULT_OK);
+    recorder.Finish(true, 1500);
+  }
+
+  CVirtualClock clock;
+  CReplayBackend replay(clock);
+  CHECK(replay.Open(szFile));
+  CHECK_EQUAL(replay.AddConnection("G:", "\\\\srv\\share", 0), 1231u);
+  CHECK_EQUAL(replay.AddConnection("G:", "\\\\srv\\share", NET_CONNECT_UPDATE_PROFILE), 53u);
+  CHECK_EQUAL(replay.AddConnection("G:", "\\\\srv\\share", 0), 53u);  // Last call repeats
+  CHECK_EQUAL(replay.AddConnection("G:", "\\\\srv\\share", NET_CONNECT_INTERACTIVE), NET_RESULT_OK);
+  CHECK_EQUAL(replay.AddConnection("H:", "\\\\srv\\share", 0), NET_RESULT_BAD_NET_NAME);  // Not recorded
+  CHECK_EQUAL(replay.CancelConnection("G:"), NET_RESULT_BAD_NET_NAME);
+
+  const std::string strResult = Finish(replay, true, 1400);
+  CHECK(strResult.find("recorded baseline: all mapped after 1500 ms (-100 ms)") != std::string::npos);
+  CHECK(strResult.find("2 call(s) not found") != std::string::npos);
+
+  std::remove(szFile);
+}
+
+
+// Recorded latencies are spent on the replay clock
+static void TestLatency(void)
+{
+  const char* szFile = "replay_latency.txt";
+  {
+    std::ofstream f(szFile);
+    f << "# WinMount record 1\n"
+      << "A\t0\t250\t0\t1231\tG:\t\\\\srv\\share\n"
+      << "A\t250\t40\t0\t0\tG:\t\\\\srv\\share\n"
+      << "# result mapped 290\n";
+  }
+
+  CVirtualClock clock;
+  CReplayBackend replay(clock);
+  CHECK(replay.Open(szFile));
+  CHECK_EQUAL(replay.AddConnection("G:", "\\\\srv\\share", 0), 1231u);
+  CHECK_EQUAL(clock.Now(), 250u);
+  CHECK_EQUAL(replay.AddConnection("G:", "\\\\srv\\share", 0), NET_RESULT_OK);
+  CHECK_EQUAL(clock.Now(), 290u);
+
+  std::remove(szFile);
+}
+
+
+// A recording that never finished has no baseline, the destructor ends it as unmapped
+static void TestMissingBaseline(void)
+{
+  const char* szFile = "replay_baseline.txt";
+  {
+    std::ofstream f(szFile);
+    f << "# WinMount record 1\n"
+      << "A\t0\t10\t0\t0\tG:\t\\\\srv\\share\n";
+  }
+
+  CVirtualClock clock;
+  {
+    CReplayBackend replay(clock);
+    CHECK(replay.Open(szFile));
+    CHECK(Finish(replay, true, 10).find("no recorded baseline") != std::string::npos);
+  }
+
+  {
+    CRecordingBackend recorder(new CScriptBackend({ NET_RESULT_OK }));
+    CHECK(recorder.Open(szFile));
+    recorder.AddConnection("G:", "\\\\srv\\share", 0);
+  }
+
+  CReplayBackend replay(clock);
+  CHECK(replay.Open(szFile));
+  const std::string strResult = Finish(replay, true, 10);
+  CHECK(strResult.find("recorded baseline: NOT all mapped") != std::string::npos);
+
+  std::remove(szFile);
+}
+
+
+// Name resolutions are recorded with the calls and replayed in order. Hosts without a recorded resolution resolve
+static void TestResolve(void)
+{
+  const char* szFile = "replay_resolve.txt";
+  {
+    CRecordingBackend recorder(new CScriptBackend({ NET_RESULT_OK }));
+    CHECK(recorder.Open(szFile));
+    CRecordingResolver resolver(new CScriptResolver({ false, true }), recorder);
+    CHECK(!resolver.Resolve("srv"));
+    CHECK(resolver.Resolve("srv"));
+    recorder.Finish(true, 100);
+  }
+
+  CVirtualClock clock;
+  CReplayBackend replay(clock);
+  CHECK(replay.Open(szFile));
+  CReplayResolver resolver(replay);
+  CHECK(!resolver.Resolve("srv"));
+  CHECK(resolver.Resolve("srv"));
+  CHECK(resolver.Resolve("srv"));        // Last resolution repeats
+  CHECK(resolver.Resolve("other"));      // Not recorded
+  CHECK(Finish(replay, true, 100).find("not found") == std::string::npos);
+
+  std::remove(szFile);
+}
+
+
+int main(void)
+{
+  TestRoundTrip();
+  TestLatency();
+  TestMissingBaseline();
+  TestResolve();
+
+  return TEST_RESULT();
+}
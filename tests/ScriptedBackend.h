@@ -0,0 +1,94 @@
+#pragma once
+#ifndef SCRIPTED_BACKEND_H
+#define SCRIPTED_BACKEND_H
+
+#include "NetBackend.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Scripted results per remote name: each connect call returns the next result, the last one repeats.
+// Interactive (dialog) calls have a script of their own
+class CScriptedBackend : public CNetBackend
+{
+  public:
+    CScriptedBackend(CClock& clock) : m_clock(clock) {};
+
+    void SetScript(const std::string& strRemote, const std::vector<NetResult>& vecResults, const NetResult interactiveResult, const uint32_t iLatency)
+    {
+      CScript& script = m_mapScripts[strRemote];
+      script.vecResults = vecResults;
+      script.interactiveResult = interactiveResult;
+      script.iLatency = iLatency;
+    };
+
+    virtual NetResult AddConnection(const std::string&, const std::string& strRemote, const uint32_t iFlags)
+    {
+      uint32_t iLatency = 0;
+      NetResult result = NET_RESULT_BAD_NET_NAME;
+      {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::map<std::string, CScript>::iterator it = m_mapScripts.find(strRemote);
+        if (it != m_mapScripts.end())
+        {
+          CScript& script = it->second;
+          iLatency = script.iLatency;
+          if (iFlags & NET_CONNECT_INTERACTIVE)
+          {
+            result = script.interactiveResult;
+            script.iDialogs++;
+          }
+          else
+            result = script.vecResults[std::min(script.iCalls, script.vecResults.size() - 1)];
+          script.iCalls++;
+        }
+      }
+
+      m_clock.Sleep(iLatency);
+      return result;
+    };
+
+    NetResult CancelConnection(const std::string&) { return NET_RESULT_OK; };
+
+    void Finish(const bool bAllMapped, const uint64_t iElapsed)
+    {
+      m_bFinished = true;
+      m_bAllMapped = bAllMapped;
+      m_iElapsed = iElapsed;
+    };
+
+    size_t GetCalls(const std::string& strRemote)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_mapScripts[strRemote].iCalls;
+    };
+
+    size_t GetDialogs(const std::string& strRemote)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      return m_mapScripts[strRemote].iDialogs;
+    };
+
+    bool m_bFinished = false;
+    bool m_bAllMapped = false;
+    uint64_t m_iElapsed = 0;
+
+  private:
+    struct CScript
+    {
+      std::vector<NetResult> vecResults;
+      NetResult interactiveResult = NET_RESULT_OK;
+      uint32_t iLatency = 0;
+      size_t iCalls = 0;                      // Including dialogs
+      size_t iDialogs = 0;
+    };
+
+    CClock& m_clock;
+    std::map<std::string, CScript> m_mapScripts;
+    std::mutex m_mutex;
+};
+
+#endif // SCRIPTED_BACKEND_H
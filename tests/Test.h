@@ -0,0 +1,24 @@
+#pragma once
+#ifndef TEST_H
+#define TEST_H
+
+#include <iostream>
+
+// Minimal checks for the test programs: report each failure and exit non-zero at the end
+static int g_iFailures = 0;
+
+#define CHECK(expr) \
+  do \
+  { \
+    if (!(expr)) \
+    { \
+      std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #expr ") failed" << std::endl; \
+      g_iFailures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(a, b) CHECK((a) == (b))
+
+#define TEST_RESULT() (g_iFailures ? (std::cerr << g_iFailures << " check(s) failed" << std::endl, 1) : 0)
+
+#endif // TEST_H
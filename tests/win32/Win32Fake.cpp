@@ -0,0 +1,174 @@
+// Fake Win32 API for building the engine on other platforms: no network, shared memory, dialogs or console input
+
+#include <windows.h>
+#include <winnetwk.h>
+#include <conio.h>
+#include <sddl.h>
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include <chrono>
+#include <thread>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include <unistd.h>
+#include <fnmatch.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+int MessageBox(HWND, LPCSTR szText, LPCSTR szCaption, UINT)
+{
+  std::cout << "[" << szCaption << "] " << szText << std::endl;
+  return 0;
+}
+
+
+void Sleep(DWORD dwMilliseconds)
+{
+  std::this_thread::sleep_for(std::chrono::milliseconds(dwMilliseconds));
+}
+
+
+ULONGLONG GetTickCount64(void)
+{
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+DWORD GetCurrentProcessId(void) { return (DWORD) getpid(); }
+DWORD GetCurrentThreadId(void) { return (DWORD) std::hash<std::thread::id>()(std::this_thread::get_id()); }
+DWORD GetLastError(void) { return ERROR_ACCESS_DENIED; }
+
+HANDLE CreateFileMapping(HANDLE, SECURITY_ATTRIBUTES*, DWORD, DWORD, DWORD, LPCSTR) { return NULL; }
+HANDLE OpenFileMapping(DWORD, BOOL, LPCSTR) { return NULL; }
+LPVOID MapViewOfFile(HANDLE, DWORD, DWORD, DWORD, size_t) { return NULL; }
+BOOL UnmapViewOfFile(const void*) { return TRUE; }
+BOOL CloseHandle(HANDLE) { return TRUE; }
+LPVOID LocalFree(LPVOID) { return NULL; }
+
+BOOL ConvertStringSecurityDescriptorToSecurityDescriptorA(LPCSTR, DWORD, LPVOID* ppDescriptor, unsigned long*)
+{
+  *ppDescriptor = NULL;
+  return TRUE;
+}
+
+
+LONG InterlockedCompareExchange(volatile LONG* pTarget, LONG lExchange, LONG lComparand)
+{
+  return __sync_val_compare_and_swap(pTarget, lComparand, lExchange);
+}
+
+
+LONG InterlockedExchange(volatile LONG* pTarget, LONG lValue)
+{
+  return __sync_lock_test_and_set(pTarget, lValue);
+}
+
+
+BOOL MoveFileEx(LPCSTR szExisting, LPCSTR szNew, DWORD)
+{
+  return rename(szExisting, szNew) == 0;
+}
+
+
+DWORD GetFileAttributes(LPCSTR szFile)
+{
+  struct stat st;
+  if (stat(szFile, &st) != 0)
+    return INVALID_FILE_ATTRIBUTES;
+
+  return S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+}
+
+
+// Directory search: "<dir>\<pattern>" (or '/')
+struct CFind
+{
+  DIR* pDir;
+  std::string strPattern;
+};
+
+
+static BOOL FindMatch(CFind* pFind, WIN32_FIND_DATA* pData)
+{
+  while (struct dirent* pEntry = readdir(pFind->pDir))
+  {
+    if (fnmatch(pFind->strPattern.c_str(), pEntry->d_name, 0) == 0)
+    {
+      strncpy(pData->cFileName, pEntry->d_name, MAX_PATH - 1);
+      pData->cFileName[MAX_PATH - 1] = 0;
+      pData->dwFileAttributes = FILE_ATTRIBUTE_NORMAL;
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+
+HANDLE FindFirstFile(LPCSTR szPattern, WIN32_FIND_DATA* pData)
+{
+  const std::string strPath(szPattern);
+  const size_t iPos = strPath.find_last_of("\\/");
+
+  CFind* pFind = new CFind;
+  pFind->pDir = opendir(iPos == std::string::npos ? "." : strPath.substr(0, iPos).c_str());
+  pFind->strPattern = strPath.substr(iPos == std::string::npos ? 0 : iPos + 1);
+  if (pFind->pDir && FindMatch(pFind, pData))
+    return pFind;
+
+  if (pFind->pDir)
+    closedir(pFind->pDir);
+  delete pFind;
+
+  return INVALID_HANDLE_VALUE;
+}
+
+
+BOOL FindNextFile(HANDLE hFind, WIN32_FIND_DATA* pData)
+{
+  return FindMatch((CFind*) hFind, pData);
+}
+
+
+BOOL FindClose(HANDLE hFind)
+{
+  CFind* pFind = (CFind*) hFind;
+  closedir(pFind->pDir);
+  delete pFind;
+
+  return TRUE;
+}
+
+
+DWORD WNetAddConnection2(NETRESOURCE*, LPCSTR, LPCSTR, DWORD) { return ERROR_NO_NETWORK; }
+DWORD WNetCancelConnection2(LPCSTR, DWORD, BOOL) { return ERROR_NOT_CONNECTED; }
+
+int _kbhit(void) { return 0; }
+int _getch(void) { return 0; }
+
+int WSAStartup(WORD, WSADATA*) { return 0; }
+int WSACleanup(void) { return 0; }
+SOCKET socket(int, int, int) { return INVALID_SOCKET; }
+int setsockopt(SOCKET, int, int, const char*, int) { return -1; }
+int bind(SOCKET, const struct sockaddr*, int) { return -1; }
+int listen(SOCKET, int) { return -1; }
+SOCKET accept(SOCKET, struct sockaddr*, int*) { return INVALID_SOCKET; }
+int recv(SOCKET, char*, int, int) { return -1; }
+int send(SOCKET, const char*, int, int) { return -1; }
+int closesocket(SOCKET) { return 0; }
+unsigned long htonl(unsigned long iHost) { return iHost; }
+u_short htons(u_short iHost) { return iHost; }
+
+int getaddrinfo(const char*, const char*, const struct addrinfo*, struct addrinfo** ppResult)
+{
+  static struct addrinfo result;
+  *ppResult = &result;
+  return 0;
+}
+
+
+void freeaddrinfo(struct addrinfo*) {}
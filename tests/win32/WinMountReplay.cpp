@@ -0,0 +1,37 @@
+// Replay driver for other platforms: runs the mapping engine on a recording made with --record on Windows.
+// The Win32 API is faked here, so it only replays (--replay is required)
+
+#include "WinMount.h"
+#include "StringUtils.h"
+
+#include <iostream>
+
+int main(int argc, char *argv[])
+{
+  std::vector<std::string> args(argv + 1, argv + argc);
+
+  bool bReplay = false;
+  for (auto& strArg : args)
+  {
+    if (StringUtils::StartsWith(strArg, "--replay="))
+      bReplay = true;
+  }
+
+  if (!bReplay)
+  {
+    std::cerr << "Usage: winmount_replay --replay=<file> [--virtual-clock] [other winmount options] [mount_file|directory ...]" << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  CWinMount WinMount;
+  if (!WinMount.ProcessCommandLine(args))
+    return EXIT_FAILURE;
+
+  if (!WinMount.ProcessIniFile())
+    return EXIT_FAILURE;
+
+  if (!WinMount.MapDrives())
+    return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#ifndef WIN32_FAKE_CONIO_H
+#define WIN32_FAKE_CONIO_H
+
+// No console input: no key is ever pressed
+int _kbhit(void);
+int _getch(void);
+
+#endif // WIN32_FAKE_CONIO_H
@@ -0,0 +1,10 @@
+#pragma once
+#ifndef WIN32_FAKE_SDDL_H
+#define WIN32_FAKE_SDDL_H
+
+#include <windows.h>
+
+#define SDDL_REVISION_1 1
+BOOL ConvertStringSecurityDescriptorToSecurityDescriptorA(LPCSTR szSddl, DWORD dwRevision, LPVOID* ppDescriptor, unsigned long* piSize);
+
+#endif // WIN32_FAKE_SDDL_H
@@ -0,0 +1,107 @@
+#pragma once
+#ifndef WIN32_FAKE_WINDOWS_H
+#define WIN32_FAKE_WINDOWS_H
+
+// Minimal stand-in for the parts of the Win32 API WinMount uses, so the engine can be built and tested
+// on other platforms (see Win32Fake.cpp). Never used for Windows builds
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef unsigned long DWORD;
+typedef unsigned short WORD;
+typedef long LONG;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef unsigned long long ULONGLONG;
+typedef char* LPSTR;
+typedef const char* LPCSTR;
+typedef void* LPVOID;
+typedef void* HANDLE;
+typedef void* HWND;
+
+#define TRUE  1
+#define FALSE 0
+#define MAX_PATH 260
+#define INFINITE 0xFFFFFFFF
+#define INVALID_HANDLE_VALUE ((HANDLE) (intptr_t) -1)
+
+#define NO_ERROR                          0L
+#define ERROR_SUCCESS                     0L
+#define ERROR_PATH_NOT_FOUND              3L
+#define ERROR_ACCESS_DENIED               5L
+#define ERROR_BAD_NETPATH                 53L
+#define ERROR_UNEXP_NET_ERR               59L
+#define ERROR_NETNAME_DELETED             64L
+#define ERROR_NETWORK_ACCESS_DENIED       65L
+#define ERROR_BAD_DEV_TYPE                66L
+#define ERROR_BAD_NET_NAME                67L
+#define ERROR_ALREADY_ASSIGNED            85L
+#define ERROR_INVALID_PASSWORD            86L
+#define ERROR_SEM_TIMEOUT                 121L
+#define ERROR_BUSY                        170L
+#define ERROR_ALREADY_EXISTS              183L
+#define ERROR_DEVICE_ALREADY_REMEMBERED   1202L
+#define ERROR_NO_NET_OR_BAD_PATH          1203L
+#define ERROR_SESSION_CREDENTIAL_CONFLICT 1219L
+#define ERROR_NO_NETWORK                  1222L
+#define ERROR_CANCELLED                   1223L
+#define ERROR_NETWORK_UNREACHABLE         1231L
+#define ERROR_HOST_UNREACHABLE            1232L
+#define ERROR_PORT_UNREACHABLE            1234L
+#define ERROR_LOGON_FAILURE               1326L
+#define ERROR_CANT_ACCESS_DOMAIN_INFO     1351L
+#define ERROR_NOT_CONNECTED               2250L
+
+// Dialogs
+#define MB_OK        0x00
+#define MB_ICONERROR 0x10
+int MessageBox(HWND hWnd, LPCSTR szText, LPCSTR szCaption, UINT uType);
+
+// Processes and time
+void Sleep(DWORD dwMilliseconds);
+ULONGLONG GetTickCount64(void);
+DWORD GetCurrentProcessId(void);
+DWORD GetCurrentThreadId(void);
+DWORD GetLastError(void);
+
+// Shared memory (no mappings can be created)
+typedef struct
+{
+  DWORD nLength;
+  LPVOID lpSecurityDescriptor;
+  BOOL bInheritHandle;
+} SECURITY_ATTRIBUTES;
+
+#define PAGE_READWRITE 0x04
+#define FILE_MAP_WRITE 0x02
+#define FILE_MAP_READ  0x04
+HANDLE CreateFileMapping(HANDLE hFile, SECURITY_ATTRIBUTES* pAttributes, DWORD flProtect, DWORD dwSizeHigh, DWORD dwSizeLow, LPCSTR szName);
+HANDLE OpenFileMapping(DWORD dwAccess, BOOL bInherit, LPCSTR szName);
+LPVOID MapViewOfFile(HANDLE hMapping, DWORD dwAccess, DWORD dwOffsetHigh, DWORD dwOffsetLow, size_t iBytes);
+BOOL UnmapViewOfFile(const void* pView);
+BOOL CloseHandle(HANDLE hObject);
+LPVOID LocalFree(LPVOID pMem);
+
+LONG InterlockedCompareExchange(volatile LONG* pTarget, LONG lExchange, LONG lComparand);
+LONG InterlockedExchange(volatile LONG* pTarget, LONG lValue);
+
+// Files
+#define MOVEFILE_REPLACE_EXISTING 0x01
+#define FILE_ATTRIBUTE_DIRECTORY  0x10
+#define FILE_ATTRIBUTE_NORMAL     0x80
+#define INVALID_FILE_ATTRIBUTES   ((DWORD) -1)
+
+typedef struct
+{
+  DWORD dwFileAttributes;
+  char cFileName[MAX_PATH];
+} WIN32_FIND_DATA;
+
+BOOL MoveFileEx(LPCSTR szExisting, LPCSTR szNew, DWORD dwFlags);
+DWORD GetFileAttributes(LPCSTR szFile);
+HANDLE FindFirstFile(LPCSTR szPattern, WIN32_FIND_DATA* pData);
+BOOL FindNextFile(HANDLE hFind, WIN32_FIND_DATA* pData);
+BOOL FindClose(HANDLE hFind);
+
+#endif // WIN32_FAKE_WINDOWS_H
@@ -0,0 +1,28 @@
+#pragma once
+#ifndef WIN32_FAKE_WINNETWK_H
+#define WIN32_FAKE_WINNETWK_H
+
+#include <windows.h>
+
+typedef struct
+{
+  DWORD dwScope;
+  DWORD dwType;
+  DWORD dwDisplayType;
+  DWORD dwUsage;
+  LPSTR lpLocalName;
+  LPSTR lpRemoteName;
+  LPSTR lpComment;
+  LPSTR lpProvider;
+} NETRESOURCE;
+
+#define RESOURCETYPE_ANY       0x00
+#define CONNECT_UPDATE_PROFILE 0x01
+#define CONNECT_INTERACTIVE    0x08
+#define CONNECT_PROMPT         0x10
+
+// There is no network: every connection fails with ERROR_NO_NETWORK
+DWORD WNetAddConnection2(NETRESOURCE* pResource, LPCSTR szPassword, LPCSTR szUser, DWORD dwFlags);
+DWORD WNetCancelConnection2(LPCSTR szName, DWORD dwFlags, BOOL bForce);
+
+#endif // WIN32_FAKE_WINNETWK_H
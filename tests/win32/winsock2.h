@@ -0,0 +1,43 @@
+#pragma once
+#ifndef WIN32_FAKE_WINSOCK2_H
+#define WIN32_FAKE_WINSOCK2_H
+
+#include <windows.h>
+#include <sys/select.h> // For fd_set/timeval
+
+typedef uintptr_t SOCKET;
+typedef unsigned short u_short;
+typedef struct { int iUnused; } WSADATA;
+
+#define MAKEWORD(a, b) ((WORD) (((a) & 0xFF) | ((b) & 0xFF) << 8))
+#define INVALID_SOCKET (~(SOCKET) 0)
+#define AF_UNSPEC 0
+#define AF_INET 2
+#define SOCK_STREAM 1
+#define IPPROTO_TCP 6
+#define INADDR_LOOPBACK 0x7F000001
+#define SOMAXCONN 5
+#define SOL_SOCKET 0xFFFF
+#define SO_EXCLUSIVEADDRUSE ((int) (~0x0004))
+#define SO_RCVTIMEO 0x1006
+#define SO_SNDTIMEO 0x1005
+
+struct in_addr { unsigned long s_addr; };
+struct sockaddr { int iUnused; };
+struct sockaddr_in { short sin_family; u_short sin_port; struct in_addr sin_addr; };
+
+// Sockets can't be created, so no metrics server
+int WSAStartup(WORD wVersion, WSADATA* pData);
+int WSACleanup(void);
+SOCKET socket(int iFamily, int iType, int iProtocol);
+int setsockopt(SOCKET sock, int iLevel, int iOption, const char* pValue, int iLength);
+int bind(SOCKET sock, const struct sockaddr* pAddr, int iLength);
+int listen(SOCKET sock, int iBacklog);
+SOCKET accept(SOCKET sock, struct sockaddr* pAddr, int* piLength);
+int recv(SOCKET sock, char* pBuffer, int iLength, int iFlags);
+int send(SOCKET sock, const char* pBuffer, int iLength, int iFlags);
+int closesocket(SOCKET sock);
+unsigned long htonl(unsigned long iHost);
+u_short htons(u_short iHost);
+
+#endif // WIN32_FAKE_WINSOCK2_H
@@ -0,0 +1,19 @@
+#pragma once
+#ifndef WIN32_FAKE_WS2TCPIP_H
+#define WIN32_FAKE_WS2TCPIP_H
+
+#include <winsock2.h>
+
+struct addrinfo
+{
+  int ai_flags;
+  int ai_family;
+  int ai_socktype;
+  int ai_protocol;
+};
+
+// Every name resolves
+int getaddrinfo(const char* szNode, const char* szService, const struct addrinfo* pHints, struct addrinfo** ppResult);
+void freeaddrinfo(struct addrinfo* pResult);
+
+#endif // WIN32_FAKE_WS2TCPIP_H